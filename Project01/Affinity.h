@@ -0,0 +1,111 @@
+#ifndef PARALLEL_COMPUTING_AFFINITY_H
+#define PARALLEL_COMPUTING_AFFINITY_H
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/* pin every thread to its own physical core,
+ * ignored when the placement is chosen with OMP_PROC_BIND or OMP_PLACES */
+#define PIN_THREADS true
+
+/* a cpu this process may run on, with its place in the topology */
+typedef struct {
+    int cpu;
+    int package;
+    int core;
+    int sibling;
+} place;
+
+/* the cpus to pin threads to, in the order they are handed out */
+int places[CPU_SETSIZE];
+int place_count = 0;
+
+/**
+ * reads a single number from the topology of a cpu, -1 if it is unknown
+ */
+int read_topology(int cpu, const char *name) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+
+    int value = -1;
+    FILE *file = fopen(path, "r");
+    if (file != NULL) {
+        if (fscanf(file, "%d", &value) != 1) {
+            value = -1;
+        }
+        fclose(file);
+    }
+
+    return value;
+}
+
+int compare_places(const void *a, const void *b) {
+    const place *x = (const place*)a, *y = (const place*)b;
+    if (x->sibling != y->sibling) return x->sibling - y->sibling;
+    if (x->package != y->package) return x->package - y->package;
+    if (x->core != y->core) return x->core - y->core;
+    return x->cpu - y->cpu;
+}
+
+/**
+ * finds the cpus this process may run on in /sys/devices/system/cpu
+ * the first hyper-thread of every physical core comes first, the cores of one socket
+ * before those of the next, so neighbouring threads share a socket and no core runs two threads
+ * until every core runs one
+ */
+void find_places() {
+    place_count = 0;
+    if (!PIN_THREADS || getenv("OMP_PROC_BIND") != NULL || getenv("OMP_PLACES") != NULL) {
+        return;
+    }
+
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return;
+    }
+
+    static place found[CPU_SETSIZE];
+    int count = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+
+        found[count].cpu = cpu;
+        found[count].package = read_topology(cpu, "physical_package_id");
+        found[count].core = read_topology(cpu, "core_id");
+
+        /* the number of cpus before this one on the same core */
+        found[count].sibling = 0;
+        for (int j = 0; j < count; j++) {
+            if (found[j].package == found[count].package && found[j].core == found[count].core) {
+                found[count].sibling++;
+            }
+        }
+        count++;
+    }
+
+    qsort(found, count, sizeof(place), compare_places);
+    for (int i = 0; i < count; i++) {
+        places[i] = found[i].cpu;
+    }
+    place_count = count;
+}
+
+/**
+ * pins the calling thread to the cpu of the given index, wrapping around when there are more threads than cpus
+ */
+void pin_thread(int index) {
+    if (place_count == 0) {
+        return;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(places[index % place_count], &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+#endif //PARALLEL_COMPUTING_AFFINITY_H
@@ -0,0 +1,147 @@
+#ifndef PARALLEL_COMPUTING_ARENA_H
+#define PARALLEL_COMPUTING_ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/* back large buffers by huge pages, reserved ones (MAP_HUGETLB) if available and transparent ones otherwise */
+#define HUGE_PAGES true
+/* reset the arena before every run, so every run maps fresh memory and pays for its page faults */
+#define COLD_RUNS false
+
+/* the alignment of every buffer, a cache line and a full AVX-512 vector */
+#define ALIGNMENT 64
+#define HUGE_PAGE (2 * 1024 * 1024)
+/* the most buffers that are in use at the same time */
+#define ARENA_SLOTS 8
+
+/* a buffer that is reused by the vectors of successive runs */
+typedef struct {
+    void *data;
+    size_t capacity;
+    bool used;
+    bool mapped;
+} buffer;
+
+buffer arena[ARENA_SLOTS];
+int arena_count = 0;
+
+size_t round_up(size_t size, size_t multiple) {
+    return (size + multiple - 1) / multiple * multiple;
+}
+
+buffer arena_map(size_t bytes) {
+    buffer b = { NULL, round_up(bytes, ALIGNMENT), false, false };
+#ifdef __linux__
+    if (HUGE_PAGES && bytes >= HUGE_PAGE) {
+        b.capacity = round_up(bytes, HUGE_PAGE);
+        void *data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        data = mmap(NULL, b.capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+        /* without reserved huge pages, ask for transparent ones */
+        if (data == MAP_FAILED) {
+            data = mmap(NULL, b.capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+            if (data != MAP_FAILED) {
+                madvise(data, b.capacity, MADV_HUGEPAGE);
+            }
+#endif
+        }
+
+        if (data != MAP_FAILED) {
+            b.data = data;
+            b.mapped = true;
+            return b;
+        }
+        b.capacity = round_up(bytes, ALIGNMENT);
+    }
+#endif
+    b.data = aligned_alloc(ALIGNMENT, b.capacity > 0 ? b.capacity : ALIGNMENT);
+    return b;
+}
+
+void arena_unmap(buffer *b) {
+#ifdef __linux__
+    if (b->mapped) {
+        munmap(b->data, b->capacity);
+        return;
+    }
+#endif
+    free(b->data);
+}
+
+/**
+ * hands out the smallest free buffer of at least the given size, its contents are undefined
+ * if none fits, the largest free buffer is unmapped and replaced by a new one,
+ * so the arena holds no more buffers than are in use at the same time
+ * exits when more than ARENA_SLOTS buffers are in use or memory runs out
+ */
+void *arena_acquire(size_t bytes) {
+    buffer *best = NULL, *largest = NULL;
+    for (int i = 0; i < arena_count; i++) {
+        buffer *b = &arena[i];
+        if (b->used) {
+            continue;
+        }
+        if (b->capacity >= bytes && (best == NULL || b->capacity < best->capacity)) {
+            best = b;
+        }
+        if (largest == NULL || b->capacity > largest->capacity) {
+            largest = b;
+        }
+    }
+
+    if (best == NULL) {
+        if (largest != NULL) {
+            arena_unmap(largest);
+            best = largest;
+        } else if (arena_count < ARENA_SLOTS) {
+            best = &arena[arena_count++];
+        } else {
+            printf("the arena has no free buffer left, raise ARENA_SLOTS above %d\n", ARENA_SLOTS);
+            exit(1);
+        }
+        *best = arena_map(bytes);
+        if (best->data == NULL) {
+            printf("could not allocate a buffer of %zu bytes\n", bytes);
+            exit(1);
+        }
+    }
+
+    best->used = true;
+    return best->data;
+}
+
+/**
+ * returns a buffer to the arena, so a later run can reuse it
+ */
+void arena_release(void *data) {
+    for (int i = 0; i < arena_count; i++) {
+        if (data != NULL && arena[i].data == data) {
+            arena[i].used = false;
+        }
+    }
+}
+
+/**
+ * unmaps every free buffer, so the next run starts from fresh memory
+ */
+void arena_reset() {
+    int count = 0;
+    for (int i = 0; i < arena_count; i++) {
+        if (arena[i].used) {
+            arena[count++] = arena[i];
+        } else {
+            arena_unmap(&arena[i]);
+        }
+    }
+    arena_count = count;
+}
+
+#endif //PARALLEL_COMPUTING_ARENA_H
@@ -0,0 +1,105 @@
+#ifndef PARALLEL_COMPUTING_COUNTERS_H
+#define PARALLEL_COMPUTING_COUNTERS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+/* count cycles, instructions and last level cache misses of every run with perf_event_open,
+ * which are printed as extra columns after the duration */
+#define COUNTERS false
+/* bytes moved between memory and the last level cache by a single miss */
+#define CACHE_LINE 64
+
+#define COUNTER_EVENTS 3
+/* the names of the extra columns */
+#define COUNTERS_HEADER ",cycles,instructions,misses,gflops,gbs,memory_gbs"
+
+/* the hardware counters of one or more threads, -1 for an event the machine or kernel does not count */
+typedef struct {
+    int fd[COUNTER_EVENTS];
+    long long value[COUNTER_EVENTS];
+} counters;
+
+/**
+ * opens and starts the cycles, instructions and last level cache misses of the calling thread,
+ * a counter only follows the thread that opens it, so every thread opens its own
+ */
+counters counters_start() {
+    counters c;
+    for (int e = 0; e < COUNTER_EVENTS; e++) {
+        c.fd[e] = -1;
+        c.value[e] = -1;
+    }
+    if (!COUNTERS) {
+        return c;
+    }
+
+#ifdef __linux__
+    const unsigned long long configs[COUNTER_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+    };
+
+    for (int e = 0; e < COUNTER_EVENTS; e++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[e];
+        /* only user space is counted, which is allowed without privileges */
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        c.fd[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+    return c;
+}
+
+/**
+ * reads and closes the counters of the calling thread
+ */
+void counters_stop(counters *c) {
+    for (int e = 0; e < COUNTER_EVENTS; e++) {
+        long long value;
+        if (c->fd[e] >= 0 && read(c->fd[e], &value, sizeof(value)) == sizeof(value)) {
+            c->value[e] = value;
+        }
+        if (c->fd[e] >= 0) {
+            close(c->fd[e]);
+        }
+        c->fd[e] = -1;
+    }
+}
+
+/**
+ * adds the counters of a thread to a total, an event stays -1 as long as no thread counted it
+ */
+void counters_add(counters *total, const counters *c) {
+    for (int e = 0; e < COUNTER_EVENTS; e++) {
+        if (c->value[e] >= 0) {
+            total->value[e] = total->value[e] < 0 ? c->value[e] : total->value[e] + c->value[e];
+        }
+    }
+}
+
+/**
+ * prints the counters and the throughput derived from them as extra columns: cycles, instructions, misses,
+ * GFLOP/s from the flops of the stencil, GB/s from the bytes the stencil has to move, and GB/s from the misses
+ * that actually reached memory, unknown values are printed as -1
+ */
+void counters_print(const counters *c, double flops, double bytes, double seconds) {
+    long long misses = c->value[2];
+    printf(",%lld,%lld,%lld,%f,%f,%f", c->value[0], c->value[1], misses,
+            seconds > 0 ? flops / seconds / 1e9 : -1.0,
+            seconds > 0 ? bytes / seconds / 1e9 : -1.0,
+            misses >= 0 && seconds > 0 ? misses * (double)CACHE_LINE / seconds / 1e9 : -1.0);
+}
+
+#endif //PARALLEL_COMPUTING_COUNTERS_H
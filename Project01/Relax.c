@@ -1,4 +1,3 @@
-#include <time.h>
 #include "relax.h"
 
 /**
@@ -13,60 +12,123 @@ void init(double *out, int n) {
 
 /**
  * individual step of the 3-point stencil
- * computes values in vector "out" from those in vector "in"
- * assuming both are of length "n"
+ * computes the values [1, end) in vector "out" from those in vector "in"
+ * the values after them are left as they are
  */
-void relax(double *in, double *out, int n) {
-    for (int i = 1; i < n - 1; i++) {
-        out[i] = 0.25 * in[i - 1] + 0.5 * in[i] + 0.25 * in[i + 1];
+void relax(double *in, double *out, int end) {
+    for (int i = 1; i < end; i++) {
+        out[i] = STENCIL(in, i);
     }
 }
 
 /**
- * checks the convergence criterion:
- * true, iff for all indices i, we have |out[i] - in[i]| <= eps
+ * checks the convergence criterion on the indices [1, end), the others have not changed:
+ * with NORM_MAX true, iff for all indices i, we have |out[i] - in[i]| <= eps
+ * with NORM_L2 true, iff the euclidean norm of out - in is <= eps
  */
-bool isStable(double *old, double *new, int n) {
+bool isStable(double *old, double *new, int end) {
+#if NORM == NORM_L2
+    double sum = 0;
+    for (int i = 1; i < end; i++) {
+        sum += (old[i] - new[i]) * (old[i] - new[i]);
+    }
+
+    return sqrt(sum) <= EPS;
+#else
     bool res = true;
-    for (int i = 1; i < n - 1; i++) {
+    for (int i = 1; i < end; i++) {
         res &= fabs(old[i] - new[i]) <= EPS;
     }
 
     return res;
+#endif
+}
+
+/**
+ * advances up to "steps" iterations from vector "from",
+ * writing them alternately into vectors "a" and "b"
+ * only the last iteration is checked, unless "checkAll" is set
+ * "from" holds iteration "iteration", and "a" and "b" hold no iteration after "reached",
+ * every step relaxes as far as either of them can have reached so older values are overwritten
+ * returns the number of the first stable iteration found, or 0 if there is none,
+ * and sets "last" to the vector holding the last computed iteration
+ */
+int advance(double *from, double *a, double *b, int n, int iteration, int reached, int steps, bool checkAll,
+        double **last) {
+    double *in = from, *out = a;
+    for (int s = 1; s <= steps; s++) {
+        out = s % 2 == 1 ? a : b;
+        int end = active(n, max(iteration + s, reached));
+        relax(in, out, end);
+
+        if ((checkAll || s == steps) && isStable(in, out, end)) {
+            *last = out;
+            return s;
+        }
+
+        in = out;
+    }
+
+    *last = out;
+    return 0;
 }
 
 void run(int n) {
-    double *old, *new, *tmp;
+    double *saved, *old, *new, *last;
+    saved = ALLOCATE(double, n);
     old = ALLOCATE(double, n);
     new = ALLOCATE(double, n);
 
+    init(saved, n);
     init(old, n);
     init(new, n);
 
     int iterations = 0;
-    clock_t start = clock();
+    double start = now();
+    counters c = counters_start();
+
+    /* "saved" always holds the last checked iteration */
+    while (!advance(saved, old, new, n, iterations, 0, CHECK_EVERY, false, &last)) {
+        if (last == old) {
+            old = saved;
+        } else {
+            new = saved;
+        }
 
-    do {
-        tmp = old;
-        old = new;
-        new = tmp;
+        saved = last;
+        iterations += CHECK_EVERY;
+    }
 
-        relax(old, new, n);
+    /* roll back and find the first stable iteration since the last check,
+     * "old" and "new" already hold iterations up to the one after CHECK_EVERY steps */
+    if (CHECK_EVERY > 1) {
+        iterations += advance(saved, old, new, n, iterations, iterations + CHECK_EVERY, CHECK_EVERY, true, &last);
+    } else {
         iterations++;
-    } while (!isStable(old, new, n));
+    }
 
-    clock_t end = clock();
-    printf("%d,%f,%f,%d,%d,%f\n", n, HEAT, EPS, 1,
-            iterations, (double)(end - start) / CLOCKS_PER_SEC);
+    double end = now();
+    counters_stop(&c);
+    printf("%d,%f,%f,%d,%d,%f", n, HEAT, EPS, 1,
+            iterations, end - start);
+    if (COUNTERS) {
+        counters_print(&c, relaxed(n, iterations) * STENCIL_FLOPS,
+                relaxed(n, iterations) * STENCIL_BYTES, end - start);
+    }
+    printf("\n");
 
-    free(old);
-    free(new);
+    RELEASE(saved);
+    RELEASE(old);
+    RELEASE(new);
 }
 
 int main() {
-    printf("size,heat,eps,threads,iterations,duration\n");
+    printf("size,heat,eps,threads,iterations,duration%s\n", COUNTERS ? COUNTERS_HEADER : "");
     for (int i = 1; i <= EVAL_STEPS; i++) {
         for (int r = 0; r < EVAL_REPEATS; r++) {
+            if (COLD_RUNS) {
+                arena_reset();
+            }
             run(EVAL_START * i);
         }
     }
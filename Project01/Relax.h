@@ -6,19 +6,90 @@
 #include <stdbool.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
+#include "arena.h"
+#include "counters.h"
 
+/* the evaluated sizes, repeats and threads, each can be overridden on the command line of the compiler with -D */
+#ifndef EVAL_START
 #define EVAL_START 50000
+#endif
+#ifndef EVAL_STEPS
 #define EVAL_STEPS 40
+#endif
+#ifndef EVAL_REPEATS
 #define EVAL_REPEATS 10
+#endif
+#ifndef MAX_THREADS
 #define MAX_THREADS 8
+#endif
 
 #define HEAT 100.0
 #define EPS 0.05
 
-#define ALLOCATE(type, size) (type*)malloc(size * sizeof(type))
+/* weights of the 3-point stencil */
+#define WEIGHT_LEFT 0.25
+#define WEIGHT_CENTER 0.5
+#define WEIGHT_RIGHT 0.25
+/* the next value of point i, the weighted sum of its neighbourhood */
+#define STENCIL(in, i) (WEIGHT_LEFT * (in)[(i) - 1] + WEIGHT_CENTER * (in)[i] + WEIGHT_RIGHT * (in)[(i) + 1])
+/* floating point operations of relaxing a single point, the weighted sum and the norm of the change */
+#define STENCIL_FLOPS 7
+/* bytes a point moves per iteration at least, the input is read and the output is read into the cache and written */
+#define STENCIL_BYTES (3 * sizeof(double))
+
+#define NORM_MAX 0
+#define NORM_L2 1
+
+/* norm of the change made by an iteration, it is stable when this is at most EPS */
+#define NORM NORM_MAX
+/* stability is only checked every CHECK_EVERY iterations,
+ * after which the first stable iteration is found by rolling back */
+#define CHECK_EVERY 1
+/* only relax and check the points the heat can have reached, which grow by one every iteration,
+ * the rest of the vector is still zero in both vectors and relaxing it would change nothing */
+#define ACTIVE_REGION true
+
+/* vectors are taken from the arena and given back to it, so successive runs reuse their memory */
+#define ALLOCATE(type, size) (type*)arena_acquire((size) * sizeof(type))
+#define RELEASE(pointer) arena_release(pointer)
 
 int min(int a, int b) {
     return a < b ? a : b;
 }
 
+int max(int a, int b) {
+    return a > b ? a : b;
+}
+
+/**
+ * the end of the indices [1, end) that iteration "iteration" has to relax,
+ * the heat at index 0 reaches index i in iteration i, so the indices after it are still zero
+ */
+int active(int n, int iteration) {
+    return ACTIVE_REGION && iteration < n - 2 ? iteration + 1 : n - 1;
+}
+
+/**
+ * the number of points the first "iterations" iterations relax together
+ */
+double relaxed(int n, int iterations) {
+    double points = 0;
+    for (int k = 1; k <= iterations; k++) {
+        points += active(n, k) - 1;
+    }
+
+    return points;
+}
+
+/**
+ * the time in seconds on a monotonic wall clock
+ * unlike clock(), this does not add up the processor time of every thread
+ */
+double now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
 #endif //PARALLEL_COMPUTING_RELAX_H
@@ -1,70 +1,112 @@
 #include <mpi.h>
-#include <time.h>
 #include "relax.h"
 
-void init(double *out, int n) {
-    memset(out, 0, n * sizeof(double));
-    out[0] = HEAT;
+/**
+ * initialise the local part "out" of the vector, starting at global index "start"
+ * "out" holds "local_n" values, with a halo value of the neighbours on either side
+ */
+void init(double *out, int local_n, int start) {
+    memset(out, 0, (local_n + 2) * sizeof(double));
+    if (start == 0) {
+        out[1] = HEAT;
+    }
 }
 
-bool relax(double *in, double *out, int n, int th, int my_rank) {
-    int local_start, local_stop, local_n;
-    bool stable  = true;
-    local_n = n/th;
-    local_start = my_rank * local_n;
-    local_stop = local_start + local_n;
-
-    for (int i = local_start + 1; i < local_stop - 1; i++) {
-        out[i] = 0.25 * in[i - 1] + 0.5 * in[i] + 0.25 * in[i + 1];
-
-        if (stable && fabs(in[i] - out[i]) > EPS) {
-            stable = false;
-        }
+/**
+ * individual step of the 3-point stencil on the local indices [first, last)
+ * returns the part of the norm of the change made on these indices:
+ * the largest absolute change for NORM_MAX, the sum of the squared changes for NORM_L2
+ */
+double relax(double *in, double *out, int first, int last) {
+    double norm = 0;
+    for (int i = first; i < last; i++) {
+        out[i] = STENCIL(in, i);
+
+#if NORM == NORM_L2
+        norm += (in[i] - out[i]) * (in[i] - out[i]);
+#else
+        double delta = fabs(in[i] - out[i]);
+        norm = delta > norm ? delta : norm;
+#endif
     }
 
-    return stable;
+    return norm;
+}
+
+/**
+ * sends the outermost local values to the neighbours
+ * and receives their outermost values into the halo
+ */
+void exchange(double *out, int local_n, int left, int right) {
+    MPI_Sendrecv(&out[1], 1, MPI_DOUBLE, left, 0,
+                 &out[local_n + 1], 1, MPI_DOUBLE, right, 0,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&out[local_n], 1, MPI_DOUBLE, right, 1,
+                 &out[0], 1, MPI_DOUBLE, left, 1,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 }
 
 void run(int n, int my_rank, int th) {
     double *old, *new, *tmp;
-    int local_iterations = 1;
 
-    old = ALLOCATE(double, n);
-    new = ALLOCATE(double, n);
+    /* every rank only allocates its own part of the vector, the last one gets the remainder */
+    int local_n = n / th;
+    int start = my_rank * local_n;
+    if (my_rank == th - 1) {
+        local_n += n % th;
+    }
 
-    init(old, n);
-    init(new, n);
+    int left = my_rank > 0 ? my_rank - 1 : MPI_PROC_NULL;
+    int right = my_rank < th - 1 ? my_rank + 1 : MPI_PROC_NULL;
+
+    /* the first and last value of the whole vector are never relaxed */
+    int first = start == 0 ? 2 : 1;
+    int last = start + local_n == n ? local_n : local_n + 1;
+
+    old = ALLOCATE(double, local_n + 2);
+    new = ALLOCATE(double, local_n + 2);
+
+    init(old, local_n, start);
+    init(new, local_n, start);
+    exchange(old, local_n, left, right);
+    exchange(new, local_n, left, right);
+
+    int iterations = 1;
+    double local_norm, norm;
+    double begin = MPI_Wtime();
+
+    while (true) {
+        /* local index i is index start + i - 1 of the whole vector, the heat has not reached the indices from active on */
+        local_norm = relax(old, new, first, min(last, active(n, iterations) - start + 1));
+        MPI_Allreduce(&local_norm, &norm, 1, MPI_DOUBLE,
+                NORM == NORM_L2 ? MPI_SUM : MPI_MAX, MPI_COMM_WORLD);
+
+#if NORM == NORM_L2
+        if (sqrt(norm) <= EPS) {
+#else
+        if (norm <= EPS) {
+#endif
+            break;
+        }
 
-    int iterations = 0;
-    clock_t start = clock();
+        exchange(new, local_n, left, right);
 
-    while (!relax(old, new, n, th, my_rank)) {
         tmp = old;
         old = new;
         new = tmp;
 
-        local_iterations++;
+        iterations++;
     }
 
-    clock_t end = clock();
-
-    if (my_rank != 0){
-        MPI_Send(&local_iterations, 1, MPI_INT, 0, 0, MPI_COMM_WORLD);
-    } else{
-        iterations = local_iterations;
-        for (int source = 1; source < th; source++){
-            MPI_Recv(&local_iterations, 1, MPI_INT, source, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            iterations += local_iterations;
-        }
-    }
+    double end = MPI_Wtime();
 
-    if (my_rank == 0){
+    if (my_rank == 0) {
         printf("%d,%f,%f,%d,%d,%f\n", n, HEAT, EPS, th,
-                iterations, (double)(end - start) / CLOCKS_PER_SEC);
+                iterations, end - begin);
     }
 
-    free(old);
-    free(new);
+    RELEASE(old);
+    RELEASE(new);
 }
 
 
@@ -74,12 +116,15 @@ int main() {
     MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &th);
 
-    if (my_rank == 0){
+    if (my_rank == 0) {
         printf("size,heat,eps,threads,iterations,duration\n");
     }
 
     for (int i = 1; i <= EVAL_STEPS; i++) {
-        for (int r = 0; r < EVAL_REPEATS; r++){
+        for (int r = 0; r < EVAL_REPEATS; r++) {
+            if (COLD_RUNS) {
+                arena_reset();
+            }
             run(EVAL_START * i, my_rank, th);
         }
     }
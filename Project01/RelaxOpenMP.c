@@ -1,78 +1,132 @@
+#define _GNU_SOURCE
 #include <omp.h>
 #include "relax.h"
-
-void init(double *out, int n) {
-    memset(out, 0, n * sizeof(double));
-    out[0] = HEAT;
-}
-
-bool relax(double *in, double *out, bool *stable, int n, int maxThreads) {
-    int i, id, threads, steps, start, end;
-    memset(stable, true, maxThreads * sizeof(bool));
-
-    #pragma omp parallel private(i, id, threads, steps)
-    {
-        id = omp_get_thread_num();
-        threads = omp_get_num_threads();
-
-        steps = ceil((double)n / threads);
-        start = id * steps + 1;
-        end = min(start + steps, n - 1);
-
-        for (i = start; i < end; i++) {
-            out[i] = 0.25 * in[i - 1] + 0.5 * in[i] + 0.25 * in[i + 1];
-
-            if (stable[id] && fabs(in[i] - out[i]) > EPS) {
-                stable[id] = false;
-            }
-        }
+#include "affinity.h"
+
+/**
+ * zeroes the indices [start, end), called by the thread that relaxes them,
+ * so their pages are placed on the memory of the socket that thread runs on
+ */
+void init(double *out, int start, int end) {
+    if (end > start) {
+        memset(out + start, 0, (end - start) * sizeof(double));
     }
+}
 
-    for (i = 0; i < maxThreads; i++) {
-        if (!stable[i]) {
-            return false;
+/**
+ * individual step of the 3-point stencil on the indices [start, end)
+ * returns whether all of these indices are stable
+ */
+bool relax(double *in, double *out, int start, int end) {
+    bool stable = true;
+    for (int i = start; i < end; i++) {
+        out[i] = STENCIL(in, i);
+
+        if (stable && fabs(in[i] - out[i]) > EPS) {
+            stable = false;
         }
     }
 
-    return true;
+    return stable;
 }
 
 void run(int n, int threads) {
-    double *old, *new, *tmp;
-    bool *stable;
-
+    double *old, *new;
     old = ALLOCATE(double, n);
     new = ALLOCATE(double, n);
-    stable = ALLOCATE(bool, threads);
-
-    init(old, n);
-    init(new, n);
 
+    /* iteration i marks unstable[i % 3], the flag of iteration i + 2 is cleared
+     * after the barrier of iteration i, when nobody reads or writes it anymore
+     * unused: gcc warns it is set but not used, as it does not count the atomic reads */
+    bool unstable[3] __attribute__((unused)) = { false, false, false };
     int iterations = 1;
+    counters total = { { -1, -1, -1 }, { -1, -1, -1 } };
     omp_set_num_threads(threads);
     double start = omp_get_wtime();
 
-    while (!relax(old, new, stable, n, threads)) {
-        tmp = old;
-        old = new;
-        new = tmp;
+    #pragma omp parallel
+    {
+        int id = omp_get_thread_num();
+        int steps = ceil((double)n / omp_get_num_threads());
+        int first = id * steps + 1;
+        int last = min(first + steps, n - 1);
+
+        pin_thread(id);
+
+        /* first touch with the same partitioning as the relaxation,
+         * the first and last thread also take the fixed outer points */
+        int touch_first = id == 0 ? 0 : min(first, n);
+        int touch_last = id == omp_get_num_threads() - 1 ? n : min(first + steps, n);
+        init(old, touch_first, touch_last);
+        init(new, touch_first, touch_last);
+        if (id == 0) {
+            old[0] = HEAT;
+            new[0] = HEAT;
+        }
+
+        #pragma omp barrier
+        counters c = counters_start();
+
+        double *in = old, *out = new, *tmp;
+        for (int i = 1; ; i++) {
+            /* the threads past the points the heat can have reached have nothing to relax yet */
+            if (!relax(in, out, first, min(last, active(n, i)))) {
+                #pragma omp atomic write
+                unstable[i % 3] = true;
+            }
+
+            #pragma omp barrier
+            bool changed;
+            #pragma omp atomic read
+            changed = unstable[i % 3];
+
+            if (!changed) {
+                if (id == 0) {
+                    iterations = i;
+                }
+                break;
+            }
 
-        iterations++;
+            if (id == 0) {
+                unstable[(i + 2) % 3] = false;
+            }
+
+            tmp = in;
+            in = out;
+            out = tmp;
+        }
+
+        counters_stop(&c);
+        #pragma omp critical
+        counters_add(&total, &c);
     }
 
     double end = omp_get_wtime();
-    printf("%d,%f,%f,%d,%d,%f\n", n, HEAT, EPS,
+    printf("%d,%f,%f,%d,%d,%f", n, HEAT, EPS,
             threads, iterations, end - start);
+    if (COUNTERS) {
+        counters_print(&total, relaxed(n, iterations) * STENCIL_FLOPS,
+                relaxed(n, iterations) * STENCIL_BYTES, end - start);
+    }
+    printf("\n");
 
-    free(old);
-    free(new);
+    RELEASE(old);
+    RELEASE(new);
 }
 
 int main() {
-    printf("size,heat,eps,threads,iterations,duration\n");
+    find_places();
+
+    printf("size,heat,eps,threads,iterations,duration%s\n", COUNTERS ? COUNTERS_HEADER : "");
     for (int i = 1; i <= EVAL_STEPS; i++) {
         for (int t = 1; t <= MAX_THREADS; t++) {
+            /* the buffers of the previous thread count were first touched by other threads,
+             * reusing them would keep their pages on the nodes those threads ran on */
+            arena_reset();
             for (int r = 0; r < EVAL_REPEATS; r++) {
+                if (COLD_RUNS) {
+                    arena_reset();
+                }
                 run(EVAL_START * i, t);
             }
         }
@@ -1,55 +1,243 @@
-#include <time.h>
 #include "relax.h"
 
+/* number of points in a tile, two buffers of this size should fit in L2 */
+#define TILE_SIZE 16384
+/* number of iterations a tile is advanced before moving on, 1 disables blocking
+ * every iteration of a block is checked, so CHECK_EVERY only applies without blocking */
+#define TILE_STEPS 8
+
 void init(double *out, int n) {
     memset(out, 0, n * sizeof(double));
     out[0] = HEAT;
 }
 
-bool relax(double *in, double *out, int n) {
-    bool stable = true;
-    for (int i = 1; i < n - 1; i++) {
-        out[i] = 0.25 * in[i - 1] + 0.5 * in[i] + 0.25 * in[i + 1];
+/**
+ * individual step of the 3-point stencil on the indices [start, end)
+ * returns the part of the norm of the change made on these indices:
+ * the largest absolute change for NORM_MAX, the sum of the squared changes for NORM_L2
+ */
+double relaxRange(double *in, double *out, int start, int end) {
+    double norm = 0;
+    for (int i = start; i < end; i++) {
+        out[i] = STENCIL(in, i);
+
+#if NORM == NORM_L2
+        norm += (in[i] - out[i]) * (in[i] - out[i]);
+#else
+        double delta = fabs(in[i] - out[i]);
+        norm = delta > norm ? delta : norm;
+#endif
+    }
+
+    return norm;
+}
+
+/**
+ * combines the norms of two ranges
+ */
+double combine(double a, double b) {
+#if NORM == NORM_L2
+    return a + b;
+#else
+    return a > b ? a : b;
+#endif
+}
+
+/**
+ * checks the convergence criterion on the norm of a whole vector
+ */
+bool isStable(double norm) {
+#if NORM == NORM_L2
+    return sqrt(norm) <= EPS;
+#else
+    return norm <= EPS;
+#endif
+}
+
+bool relax(double *in, double *out, int end) {
+    return isStable(relaxRange(in, out, 1, end));
+}
+
+/**
+ * individual step of the 3-point stencil on the indices [1, end) without checking for convergence
+ */
+void sweep(double *in, double *out, int end) {
+    for (int i = 1; i < end; i++) {
+        out[i] = STENCIL(in, i);
+    }
+}
 
-        if (stable && fabs(in[i] - out[i]) > EPS) {
-            stable = false;
+/**
+ * advances up to "steps" iterations from vector "from",
+ * writing them alternately into vectors "a" and "b"
+ * only the last iteration is checked, unless "checkAll" is set
+ * "from" holds iteration "iteration", and "a" and "b" hold no iteration after "reached",
+ * every step relaxes as far as either of them can have reached so older values are overwritten
+ * returns the number of the first stable iteration found, or 0 if there is none,
+ * and sets "last" to the vector holding the last computed iteration
+ */
+int advance(double *from, double *a, double *b, int n, int iteration, int reached, int steps, bool checkAll,
+        double **last) {
+    double *in = from, *out = a;
+    for (int s = 1; s <= steps; s++) {
+        out = s % 2 == 1 ? a : b;
+        int end = active(n, max(iteration + s, reached));
+        if (checkAll || s == steps) {
+            if (relax(in, out, end)) {
+                *last = out;
+                return s;
+            }
+        } else {
+            sweep(in, out, end);
         }
+
+        in = out;
     }
 
-    return stable;
+    *last = out;
+    return 0;
+}
+
+/**
+ * advances "steps" iterations of the 3-point stencil, one tile at a time
+ * every step of a tile is shifted one point to the left of the previous step,
+ * so the values it depends on are still present in the two buffers
+ * iteration s reads from "in" when s is even and from "out" when s is odd
+ * "in" holds iteration "iteration", and its values that can be non-zero are copied into "snapshot"
+ * returns the first iteration that is stable, or -1 if none of them are
+ */
+int relaxBlocked(double *in, double *out, double *snapshot, int n, int iteration, int steps) {
+    double norm[TILE_STEPS];
+    memset(norm, 0, steps * sizeof(double));
+
+    /* tiles past the points the last step can reach are left out */
+    int known = active(n, iteration);
+    int bound = active(n, iteration + steps) + steps - 1;
+    for (int lo = 1; lo < bound; lo += TILE_SIZE) {
+        int hi = lo + TILE_SIZE;
+        if (lo < known) {
+            memcpy(&snapshot[lo], &in[lo], (min(hi, known) - lo) * sizeof(double));
+        }
+
+        for (int s = 0; s < steps; s++) {
+            double *src = s % 2 == 0 ? in : out;
+            double *dst = s % 2 == 0 ? out : in;
+            int start = lo - s < 1 ? 1 : lo - s;
+            int end = min(hi - s, active(n, iteration + s + 1));
+
+            if (start < end) {
+                norm[s] = combine(norm[s], relaxRange(src, dst, start, end));
+            }
+        }
+    }
+
+    for (int s = 0; s < steps; s++) {
+        if (isStable(norm[s])) {
+            return s;
+        }
+    }
+
+    return -1;
 }
 
 void run(int n) {
-    double *old, *new, *tmp;
+    double *old, *new;
     old = ALLOCATE(double, n);
     new = ALLOCATE(double, n);
 
     init(old, n);
     init(new, n);
 
-    int iterations = 1;
-    clock_t start = clock();
+    int iterations = 0;
+    double start = now();
+    counters c = counters_start();
+
+#if TILE_STEPS > 1
+    double *snapshot = ALLOCATE(double, n), *tmp;
+
+    int first;
+    while ((first = relaxBlocked(old, new, snapshot, n, iterations, TILE_STEPS)) < 0) {
+        if (TILE_STEPS % 2 == 1) {
+            tmp = old;
+            old = new;
+            new = tmp;
+        }
+
+        iterations += TILE_STEPS;
+    }
 
-    while (!relax(old, new, n)) {
+    /* roll back and replay the block up to the first stable iteration,
+     * so that "old" and "new" hold the same values as the unblocked loop,
+     * the values the block left after the snapshot are cleared and every replayed step overwrites them */
+    int known = active(n, iterations);
+    int reached = active(n, iterations + TILE_STEPS);
+    iterations += first + 1;
+    if (first < TILE_STEPS - 1) {
+        memcpy(&old[1], &snapshot[1], (known - 1) * sizeof(double));
+        memset(&old[known], 0, (reached - known) * sizeof(double));
+        sweep(old, new, reached);
+        for (int s = 0; s < first; s++) {
+            tmp = old;
+            old = new;
+            new = tmp;
+
+            sweep(old, new, reached);
+        }
+    } else if (TILE_STEPS % 2 == 0) {
         tmp = old;
         old = new;
         new = tmp;
+    }
+
+    RELEASE(snapshot);
+#else
+    /* "saved" always holds the last checked iteration */
+    double *saved = ALLOCATE(double, n), *last;
+    init(saved, n);
+
+    while (!advance(saved, old, new, n, iterations, 0, CHECK_EVERY, false, &last)) {
+        if (last == old) {
+            old = saved;
+        } else {
+            new = saved;
+        }
+
+        saved = last;
+        iterations += CHECK_EVERY;
+    }
 
+    /* roll back and find the first stable iteration since the last check,
+     * "old" and "new" already hold iterations up to the one after CHECK_EVERY steps */
+    if (CHECK_EVERY > 1) {
+        iterations += advance(saved, old, new, n, iterations, iterations + CHECK_EVERY, CHECK_EVERY, true, &last);
+    } else {
         iterations++;
     }
 
-    clock_t end = clock();
-    printf("%d,%f,%f,%d,%d,%f\n", n, HEAT, EPS, 1,
-            iterations, (double)(end - start) / CLOCKS_PER_SEC);
+    RELEASE(saved);
+#endif
+
+    double end = now();
+    counters_stop(&c);
+    printf("%d,%f,%f,%d,%d,%f", n, HEAT, EPS, 1,
+            iterations, end - start);
+    if (COUNTERS) {
+        counters_print(&c, relaxed(n, iterations) * STENCIL_FLOPS,
+                relaxed(n, iterations) * STENCIL_BYTES, end - start);
+    }
+    printf("\n");
 
-    free(old);
-    free(new);
+    RELEASE(old);
+    RELEASE(new);
 }
 
 int main() {
-    printf("size,heat,eps,threads,iterations,duration\n");
+    printf("size,heat,eps,threads,iterations,duration%s\n", COUNTERS ? COUNTERS_HEADER : "");
     for (int i = 1; i <= EVAL_STEPS; i++) {
         for (int r = 0; r < EVAL_REPEATS; r++) {
+            if (COLD_RUNS) {
+                arena_reset();
+            }
             run(EVAL_START * i);
         }
     }
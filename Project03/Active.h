@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Shared.h"
+
+// only sweep and check the points around the heat that can have changed, which grow by the reach of the stencil
+// every iteration, the rest of the matrix is still 0 in every matrix and sweeping it would change nothing
+#define ACTIVE_REGION true
+// the columns of the region start and end at multiples of this many points from the first inner column,
+// so the vector kernels add up the change of every point in the same lane as when sweeping whole rows
+#define ACTIVE_ALIGN 8
+
+/// <summary>The rows [y0, y1) and columns [x0, x1) of a matrix that are swept.</summary>
+struct Region {
+    size_t y0;
+    size_t y1;
+    size_t x0;
+    size_t x1;
+};
+
+class Active {
+public:
+    /// <summary>The inner points of a matrix, which are all swept without a region.</summary>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="rows">The number of rows of the matrix.</param>
+    inline static Region Inner(size_t n, size_t rows) {
+        return { 1, rows - 1, 1, n - 1 };
+    }
+
+    /// <summary>The inner points an iteration can change when the matrix starts out as 0 apart from a single hot point,
+    /// those the stencil reaches from the points that have changed before.</summary>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="rows">The number of rows of the matrix.</param>
+    /// <param name="heatIndex">The index of the hot point.</param>
+    /// <param name="iteration">The iteration, starting at 1.</param>
+    /// <returns>The region to sweep, all inner points when ACTIVE_REGION is disabled.</returns>
+    inline static Region Get(size_t n, size_t rows, size_t heatIndex, int iteration) {
+        Region region = Inner(n, rows);
+        if (!ACTIVE_REGION) {
+            return region;
+        }
+
+        size_t grow = (size_t)iteration * STENCIL.Reach();
+        size_t y = heatIndex / n, x = heatIndex % n;
+        region.y0 = y > grow + 1 ? y - grow : 1;
+        region.y1 = y + grow + 1 < rows - 1 ? y + grow + 1 : rows - 1;
+        region.x0 = x > grow + 1 ? x - grow : 1;
+        region.x1 = x + grow + 1 < n - 1 ? x + grow + 1 : n - 1;
+
+        region.x0 = 1 + (region.x0 - 1) / ACTIVE_ALIGN * ACTIVE_ALIGN;
+        region.x1 = 1 + (region.x1 - 1 + ACTIVE_ALIGN - 1) / ACTIVE_ALIGN * ACTIVE_ALIGN;
+        region.x1 = region.x1 < n - 1 ? region.x1 : n - 1;
+        return region;
+    }
+
+    /// <summary>The number of points the first iterations sweep together.</summary>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="rows">The number of rows of the matrix.</param>
+    /// <param name="heatIndex">The index of the hot point.</param>
+    /// <param name="iterations">The number of iterations.</param>
+    inline static double Points(size_t n, size_t rows, size_t heatIndex, int iterations) {
+        double points = 0.0;
+        for (int i = 1; i <= iterations; i++) {
+            Region region = Get(n, rows, heatIndex, i);
+            points += (double)(region.y1 - region.y0) * (region.x1 - region.x0);
+        }
+
+        return points;
+    }
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// pin every thread to its own physical core, ignored when the placement is chosen with OMP_PROC_BIND or OMP_PLACES
+#define PIN_THREADS true
+
+class Affinity {
+public:
+    /// <summary>The number of threads of a parallel region.</summary>
+    inline static int Threads() {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    /// <summary>Finds the cpus this process may run on, in the order threads are pinned to them.
+    /// The first hyper-thread of every physical core comes first, the cores of one socket before those of the next,
+    /// so neighbouring threads share a socket and no core runs two threads until every core runs one.</summary>
+    /// <returns>The cpus, empty if threads should not be pinned.</returns>
+    inline static const std::vector<int>& Places() {
+        static std::vector<int> places = FindPlaces();
+        return places;
+    }
+
+    /// <summary>Pins every thread of the following parallel regions to its own cpu.
+    /// OpenMP keeps its threads between regions, so this holds as long as the number of threads does not change.</summary>
+    /// <param name="offset">The index of the place of the first thread, so processes on one node use different cores.</param>
+    inline static void Pin(int offset = 0) {
+        const std::vector<int>& places = Places();
+        if (places.empty()) {
+            return;
+        }
+
+        #pragma omp parallel
+        {
+            int id = 0;
+#ifdef _OPENMP
+            id = omp_get_thread_num();
+#endif
+            PinThread(places[(offset + id) % places.size()]);
+        }
+    }
+
+private:
+    /// <summary>A cpu with its place in the topology.</summary>
+    struct Place {
+        int cpu;
+        int package;
+        int core;
+        int sibling;    // number of cpus before this one on the same core
+    };
+
+    /// <summary>Reads a single number from the topology of a cpu.</summary>
+    /// <returns>The number, -1 if it is unknown.</returns>
+    inline static int ReadTopology(int cpu, const char* name) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, name);
+
+        int value = -1;
+        FILE* file = fopen(path, "r");
+        if (file != NULL) {
+            if (fscanf(file, "%d", &value) != 1) {
+                value = -1;
+            }
+            fclose(file);
+        }
+
+        return value;
+    }
+
+    inline static std::vector<int> FindPlaces() {
+        std::vector<int> places;
+#ifdef __linux__
+        if (!PIN_THREADS || getenv("OMP_PROC_BIND") != NULL || getenv("OMP_PLACES") != NULL) {
+            return places;
+        }
+
+        cpu_set_t allowed;
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+            return places;
+        }
+
+        std::vector<Place> found;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (!CPU_ISSET(cpu, &allowed)) {
+                continue;
+            }
+
+            Place place = { cpu, ReadTopology(cpu, "physical_package_id"), ReadTopology(cpu, "core_id"), 0 };
+            for (const Place& other : found) {
+                if (other.package == place.package && other.core == place.core) {
+                    place.sibling++;
+                }
+            }
+            found.push_back(place);
+        }
+
+        std::sort(found.begin(), found.end(), [](const Place& a, const Place& b) {
+            if (a.sibling != b.sibling) return a.sibling < b.sibling;
+            if (a.package != b.package) return a.package < b.package;
+            if (a.core != b.core) return a.core < b.core;
+            return a.cpu < b.cpu;
+        });
+        for (const Place& place : found) {
+            places.push_back(place.cpu);
+        }
+#endif
+        return places;
+    }
+
+    inline static void PinThread(int cpu) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+#endif
+    }
+};
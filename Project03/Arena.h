@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// back large buffers by huge pages, reserved ones (MAP_HUGETLB) if available and transparent ones otherwise
+#define HUGE_PAGES true
+// reset the arena before every run, so every run maps fresh memory and pays for its page faults
+#define COLD_RUNS false
+
+/// <summary>Buffers that are reused by the matrices of successive runs, so a run does not pay for
+/// mapping and faulting in its memory unless the arena was reset. Not thread-safe.</summary>
+class Arena {
+public:
+    /// <summary>The alignment of every buffer, a cache line and a full AVX-512 vector.</summary>
+    static constexpr size_t alignment = 64;
+    /// <summary>The size of a huge page.</summary>
+    static constexpr size_t hugePage = 2 * 1024 * 1024;
+
+    /// <summary>Hands out a free buffer of at least the given size, the smallest one that fits.
+    /// If none fits, the largest free buffer is unmapped and replaced by a new one,
+    /// so the arena holds no more buffers than are in use at the same time. Exits when memory runs out.</summary>
+    /// <param name="bytes">The size of the buffer.</param>
+    /// <returns>A buffer aligned to at least 64 bytes, its contents are undefined.</returns>
+    inline static void* Acquire(size_t bytes) {
+        Buffer* best = NULL;
+        Buffer* largest = NULL;
+        for (Buffer& buffer : buffers) {
+            if (buffer.used) {
+                continue;
+            }
+            if (buffer.capacity >= bytes && (best == NULL || buffer.capacity < best->capacity)) {
+                best = &buffer;
+            }
+            if (largest == NULL || buffer.capacity > largest->capacity) {
+                largest = &buffer;
+            }
+        }
+
+        if (best == NULL) {
+            if (largest != NULL) {
+                Unmap(*largest);
+                *largest = Map(bytes);
+                best = largest;
+            } else {
+                buffers.push_back(Map(bytes));
+                best = &buffers.back();
+            }
+        }
+
+        best->used = true;
+        return best->data;
+    }
+
+    /// <summary>Returns a buffer to the arena, so a later matrix can reuse it.</summary>
+    /// <param name="data">A buffer of Acquire, or NULL.</param>
+    inline static void Release(void* data) {
+        if (data == NULL) {
+            return;
+        }
+
+        for (Buffer& buffer : buffers) {
+            if (buffer.data == data) {
+                buffer.used = false;
+            }
+        }
+    }
+
+    /// <summary>Unmaps every free buffer, so the next run starts from fresh memory.</summary>
+    inline static void Reset() {
+        std::vector<Buffer> used;
+        for (Buffer& buffer : buffers) {
+            if (buffer.used) {
+                used.push_back(buffer);
+            } else {
+                Unmap(buffer);
+            }
+        }
+
+        buffers = used;
+    }
+
+private:
+    struct Buffer {
+        void* data;
+        size_t capacity;
+        bool used;
+        bool mapped;
+    };
+
+    inline static std::vector<Buffer> buffers;
+
+    inline static Buffer Map(size_t bytes) {
+        Buffer buffer = { NULL, (bytes + alignment - 1) / alignment * alignment, false, false };
+#ifdef __linux__
+        if (HUGE_PAGES && bytes >= hugePage) {
+            buffer.capacity = (bytes + hugePage - 1) / hugePage * hugePage;
+#ifdef MAP_HUGETLB
+            buffer.data = mmap(NULL, buffer.capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+            // without reserved huge pages, ask for transparent ones
+            if (buffer.data == NULL || buffer.data == MAP_FAILED) {
+                buffer.data = mmap(NULL, buffer.capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+                if (buffer.data != MAP_FAILED) {
+                    madvise(buffer.data, buffer.capacity, MADV_HUGEPAGE);
+                }
+#endif
+            }
+
+            if (buffer.data != MAP_FAILED) {
+                buffer.mapped = true;
+                return buffer;
+            }
+            buffer.capacity = (bytes + alignment - 1) / alignment * alignment;
+        }
+#endif
+        buffer.data = aligned_alloc(alignment, buffer.capacity > 0 ? buffer.capacity : alignment);
+        if (buffer.data == NULL) {
+            printf("Could not allocate a buffer of %zu bytes.\n", bytes);
+            exit(1);
+        }
+        return buffer;
+    }
+
+    inline static void Unmap(Buffer& buffer) {
+#ifdef __linux__
+        if (buffer.mapped) {
+            munmap(buffer.data, buffer.capacity);
+            return;
+        }
+#endif
+        free(buffer.data);
+    }
+};
@@ -0,0 +1,297 @@
+#include "Shared.h"
+#include "Jacobi.h"
+#include "Multigrid.h"
+#include "RedBlack.h"
+#include "Volume.h"
+#include "OutOfCore.h"
+#include "Distributed.h"
+#include "Affinity.h"
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// number of runs of every size that are not measured, so caches, page tables and the arena are warm
+#define WARMUP 1
+// quantile of the standard normal distribution of the confidence interval of the median, 1.96 for 95%
+#define CONFIDENCE 1.96
+
+/// <summary>The parameters of a benchmark, set on the command line.</summary>
+struct Options {
+    std::string solver = "relax";
+    std::vector<long> sizes;
+    std::vector<long> threads;
+    int repeats = REPEATS;
+    int warmup = WARMUP;
+    double heat = HEAT;
+    double eps = EPS;
+    std::string output;
+};
+
+/// <summary>The times of the repeats of a single size and number of threads, in milliseconds.</summary>
+struct Summary {
+    double median;
+    double min;
+    double p95;
+    double low;     // lower bound of the confidence interval of the median
+    double high;    // upper bound of the confidence interval of the median
+};
+
+/// <summary>Prints the command line options and exits.</summary>
+static void Usage(const char* program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  --solver NAME     relax, tiled, redblack, multigrid, relax3d, disk or mpi (default relax)\n");
+    printf("  --sizes LIST      widths of the matrix, e.g. 100,200 or 100:1000:100 (default N to STEPS*N)\n");
+    printf("  --threads LIST    numbers of threads, e.g. 1,2,4 or 1:8:1 (default all)\n");
+    printf("  --repeats COUNT   measured runs of every size (default %d)\n", REPEATS);
+    printf("  --warmup COUNT    unmeasured runs before them (default %d)\n", WARMUP);
+    printf("  --heat VALUE      heat value (default %g)\n", HEAT);
+    printf("  --eps VALUE       epsilon value (default %g)\n", EPS);
+    printf("  --output NAME     csv file in Evaluation (default bench_SOLVER)\n");
+    exit(1);
+}
+
+/// <summary>Parses a comma separated list of numbers and ranges start:end:step, where end is included.</summary>
+static std::vector<long> ParseList(const char* text) {
+    std::vector<long> list;
+    std::string items(text);
+    size_t begin = 0;
+    while (begin <= items.size()) {
+        size_t end = items.find(',', begin);
+        end = end == std::string::npos ? items.size() : end;
+
+        long first, last, step = 1;
+        int count = sscanf(items.substr(begin, end - begin).c_str(), "%ld:%ld:%ld", &first, &last, &step);
+        if (count < 1 || step < 1) {
+            printf("Could not parse '%s'.\n", text);
+            exit(1);
+        }
+        if (count == 1) {
+            last = first;
+        }
+        for (long value = first; value <= last; value += step) {
+            list.push_back(value);
+        }
+
+        begin = end + 1;
+    }
+
+    return list;
+}
+
+static Options ParseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            Usage(argv[0]);
+        }
+
+        const char* value = argv[++i];
+        if (strcmp(argv[i - 1], "--solver") == 0) {
+            options.solver = value;
+        } else if (strcmp(argv[i - 1], "--sizes") == 0) {
+            options.sizes = ParseList(value);
+        } else if (strcmp(argv[i - 1], "--threads") == 0) {
+            options.threads = ParseList(value);
+        } else if (strcmp(argv[i - 1], "--repeats") == 0) {
+            options.repeats = atoi(value);
+        } else if (strcmp(argv[i - 1], "--warmup") == 0) {
+            options.warmup = atoi(value);
+        } else if (strcmp(argv[i - 1], "--heat") == 0) {
+            options.heat = atof(value);
+        } else if (strcmp(argv[i - 1], "--eps") == 0) {
+            options.eps = atof(value);
+        } else if (strcmp(argv[i - 1], "--output") == 0) {
+            options.output = value;
+        } else {
+            Usage(argv[0]);
+        }
+    }
+
+    bool volume = options.solver == "relax3d";
+    if (options.sizes.empty()) {
+        for (int i = 1; i <= STEPS; i++) {
+            options.sizes.push_back(i * (volume ? N_3D : N));
+        }
+    }
+    if (options.threads.empty()) {
+        options.threads.push_back(Affinity::Threads());
+    }
+    if (options.output.empty()) {
+        options.output = "bench_" + options.solver;
+    }
+    if (options.repeats < 1) {
+        Usage(argv[0]);
+    }
+
+    return options;
+}
+
+/// <summary>Solves a single matrix, including creating and freeing it, like the drivers of the solvers do.
+/// Checkpoints of earlier runs are never continued from, so every timed run does all of its iterations.</summary>
+/// <param name="solver">The name of the solver.</param>
+/// <param name="n">The width of the matrix.</param>
+/// <returns>The number of iterations.</returns>
+static int Solve(const std::string& solver, size_t n, double heat, double eps) {
+    int iterations;
+    if (solver == "mpi") {
+        Block block = Distributed::CreateBlock(n);
+        Checkpoint checkpoint;
+        Checkpoints::Create(checkpoint, "bench", n, heat, eps, false);
+        iterations = Distributed::Solve(block, n, heat, eps, checkpoint);
+        Distributed::FreeBlock(block);
+        return iterations;
+    }
+
+    if (solver == "relax3d") {
+        double* in = Shared::CreateMatrix(n * n * n, (int)Volume::GetHeatIndex(n), heat);
+        double* out = Shared::CreateMatrix(n * n * n, (int)Volume::GetHeatIndex(n), heat);
+        iterations = Volume::Solve(in, out, n, eps, Volume::GetTile(n - 2, n - 2));
+        Shared::FreeMatrix(in);
+        Shared::FreeMatrix(out);
+        return iterations;
+    }
+
+    if (solver == "disk") {
+        DiskMatrix a = OutOfCore::CreateMatrix("bench_a", n, n / 2, heat);
+        DiskMatrix b = OutOfCore::CreateMatrix("bench_b", n, n / 2, heat);
+        DiskMatrix* last;
+        size_t streamed;
+        iterations = OutOfCore::Solve(a, b, n, eps, last, streamed);
+        OutOfCore::FreeMatrix(a);
+        OutOfCore::FreeMatrix(b);
+        return iterations;
+    }
+
+    double* in = Shared::CreateMatrix(n * n, n / 2, heat);
+    double* out = NULL;
+    double* saved = NULL;
+    if (solver == "relax" || solver == "tiled") {
+        out = Shared::CreateMatrix(n * n, n / 2, heat);
+        saved = Shared::CreateMatrix(n * n, n / 2, heat);
+        Checkpoint checkpoint;
+        Checkpoints::Create(checkpoint, "bench", n, heat, eps, false);
+        iterations = Jacobi::Iterate(saved, in, out, n, n / 2, eps, solver == "tiled", checkpoint);
+        Checkpoints::Finish(checkpoint);
+    } else if (solver == "redblack") {
+        iterations = RedBlack::Solve(in, n, eps);
+    } else if (solver == "multigrid") {
+        out = Shared::CreateMatrix(n * n, n / 2, heat);
+        Multigrid::Solve(in, out, n, eps, iterations);
+    } else {
+        printf("Unknown solver '%s'.\n", solver.c_str());
+        exit(1);
+    }
+
+    Shared::FreeMatrix(saved);
+    Shared::FreeMatrix(in);
+    Shared::FreeMatrix(out);
+    return iterations;
+}
+
+/// <summary>Summarises the times of the repeats. The confidence interval of the median is distribution-free:
+/// its bounds are the order statistics around the median that hold it with the confidence of CONFIDENCE,
+/// so with few repeats it widens to the extremes instead of assuming the times are normally distributed.</summary>
+/// <param name="times">The times, which are sorted.</param>
+static Summary Summarise(std::vector<double>& times) {
+    std::sort(times.begin(), times.end());
+    size_t count = times.size();
+
+    Summary summary;
+    summary.median = count % 2 == 1 ? times[count / 2] : (times[count / 2 - 1] + times[count / 2]) / 2;
+    summary.min = times[0];
+    summary.p95 = times[(size_t)ceil(0.95 * count) - 1];
+
+    double spread = CONFIDENCE * sqrt((double)count) / 2;
+    long low = (long)floor(count / 2.0 - spread);
+    long high = (long)ceil(count / 2.0 + spread);
+    summary.low = times[low < 1 ? 0 : low - 1];
+    summary.high = times[high > (long)count ? count - 1 : high - 1];
+    return summary;
+}
+
+/// <summary>Runs any solver for the sizes and numbers of threads on the command line and writes a row per size
+/// and number of threads. Every run is timed on a monotonic wall clock, and Time is the median of the repeats,
+/// so the notebooks in Evaluation read the file like the ones of the drivers, with Cores as the number of processes
+/// times the number of threads. Min, P95 and the confidence interval [Low, High] of the median are in milliseconds
+/// as well. The mpi solver runs with mpirun, the time of a run is that of its slowest process.</summary>
+int main(int argc, char** argv) {
+    bool threaded = Distributed::Init(&argc, &argv);
+    Options options = ParseOptions(argc, argv);
+
+    int rank, worldSize;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+    if (worldSize > 1 && options.solver != "mpi") {
+        if (rank == 0) {
+            printf("Only the mpi solver runs on more than one process.\n");
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    int dims = options.solver == "relax3d" ? 3 : 2;
+    std::ofstream file;
+    if (rank == 0) {
+        file = Shared::OpenFile(options.output, "Cores,N,Size,Iterations,Time,Min,P95,Low,High,Repeats");
+    }
+
+    for (long threads : options.threads) {
+        if (!threaded && threads > 1) {
+            if (rank == 0) {
+                printf("Skipping %ld threads, MPI does not support threads.\n", threads);
+            }
+            continue;
+        }
+#ifdef _OPENMP
+        omp_set_num_threads((int)threads);
+#endif
+        // the processes on a node pin their threads to different cores
+        Affinity::Pin(Distributed::LocalRank() * Affinity::Threads());
+        // the matrices of the previous number of threads were first touched by other threads,
+        // reusing them would keep their pages on the nodes those threads ran on
+        Arena::Reset();
+
+        for (long n : options.sizes) {
+            int iterations = 0;
+            std::vector<double> times;
+            for (int r = -options.warmup; r < options.repeats; r++) {
+                if (COLD_RUNS) {
+                    Arena::Reset();
+                }
+
+                MPI_Barrier(MPI_COMM_WORLD);
+                double start = Shared::Now();
+                iterations = Solve(options.solver, n, options.heat, options.eps);
+                double ms = Shared::Now() - start;
+                MPI_Allreduce(MPI_IN_PLACE, &ms, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+                if (r >= 0) {
+                    times.push_back(ms);
+                }
+            }
+
+            if (rank != 0) {
+                continue;
+            }
+
+            Summary summary = Summarise(times);
+            file << worldSize * threads << ","
+                 << n << ","
+                 << (int)(pow(n, dims) * sizeof(double) / (1024 * 1024)) << ","
+                 << iterations << ","
+                 << summary.median << ","
+                 << summary.min << ","
+                 << summary.p95 << ","
+                 << summary.low << ","
+                 << summary.high << ","
+                 << options.repeats << std::endl;
+            printf("%s processes=%d threads=%ld N=%ld iterations=%d median=%.2fms min=%.2fms p95=%.2fms ci=[%.2f, %.2f]ms\n",
+                   options.solver.c_str(), worldSize, threads, n, iterations,
+                   summary.median, summary.min, summary.p95, summary.low, summary.high);
+        }
+    }
+
+    file.close();
+    MPI_Finalize();
+    return 0;
+}
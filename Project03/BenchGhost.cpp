@@ -0,0 +1,63 @@
+#include "Shared.h"
+#include "Distributed.h"
+
+// largest halo width to try, widths are doubled starting at 1
+#define MAX_GHOST 32
+
+/// <summary>Compares halo widths for the same sizes as RelaxMPI.cpp.
+/// Run it with mpirun for every number of processes to compare, all results are appended to ghost.csv.</summary>
+int main(int argc, char** argv) {
+    Distributed::Init(&argc, &argv);
+
+    // the processes on a node pin their threads to different cores
+    Affinity::Pin(Distributed::LocalRank() * Affinity::Threads());
+
+    int rank, worldSize;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+
+    std::ofstream file;
+    if (rank == 0) {
+        file = Shared::OpenFile("ghost", "Cores,N,Ghost,Iterations,Time");
+    }
+
+    for (int i = 1; i <= STEPS; i++) {
+        size_t n = i * N;
+        for (size_t ghost = 1; ghost <= MAX_GHOST; ghost *= 2) {
+            for (int r = 0; r < REPEATS; r++) {
+                MPI_Barrier(MPI_COMM_WORLD);
+                double start = MPI_Wtime();
+
+                Block block = Distributed::CreateBlock(n, ghost);
+                if (ghost >= n / block.dims[0] || ghost >= n / block.dims[1]) { // halo wider than a block
+                    Distributed::FreeBlock(block);
+                    break;
+                }
+
+                // a checkpoint left by an earlier run must not shorten a timed one
+                Checkpoint checkpoint;
+                Checkpoints::Create(checkpoint, "bench", n, HEAT, EPS, false);
+                int iterations = Distributed::Solve(block, n, HEAT, EPS, checkpoint);
+                double end = MPI_Wtime();
+                Distributed::FreeBlock(block);
+
+                if (rank == 0) {
+                    file << worldSize << ","
+                         << n << ","
+                         << ghost << ","
+                         << iterations << ","
+                         << (int)((end - start) * 1000.0) << std::endl;
+                    printf("Cores=%d N=%zu Ghost=%zu Iterations=%d Time=%dms\n",
+                           worldSize, n, ghost, iterations, (int)((end - start) * 1000.0));
+                }
+            }
+        }
+    }
+
+    if (rank == 0) {
+        file.close();
+    }
+
+    MPI_Finalize();
+    return 0;
+}
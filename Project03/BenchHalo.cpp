@@ -0,0 +1,156 @@
+#include "Shared.h"
+#include "Distributed.h"
+#include "Tiling.h"
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+// number of exchanges or sweeps that are timed together
+#define HALO_STEPS 100
+// number of times they are timed, the median and the fastest time are written
+#define HALO_REPEATS 10
+// the matrices that are resident in memory are this many times as large as the last level cache of a process
+#define DRAM_FACTOR 4
+
+/// <summary>A path of the halo exchange, run once on the matrix of a block.</summary>
+typedef void (*Path)(const Block& block, double* in, double* out, std::vector<char>& buffer);
+
+/// <summary>Sweeps the block without exchanging its halo, the work the exchange is compared with.</summary>
+static void Relax(const Block& block, double* in, double* out, std::vector<char>&) {
+    Distributed::Relax(block, in, out);
+}
+
+/// <summary>Exchanges the halo with the blocking sends and receives of the solvers.</summary>
+static void SendRecv(const Block& block, double*, double* out, std::vector<char>&) {
+    Distributed::UpdateNeighbours(block, out);
+}
+
+/// <summary>Packs the outer rows and columns that are sent and unpacks them into the halo, without sending them,
+/// which is the copying MPI does for the strided datatypes of the halo.</summary>
+static void Pack(const Block& block, double*, double* out, std::vector<char>& buffer) {
+    size_t w = block.width, h = block.halo, rows = block.rows, cols = block.cols;
+    const MPI_Datatype types[4] = { block.row, block.row, block.column, block.column };
+    const size_t from[4] = { h * w + h, rows * w + h, h, cols };
+    const size_t to[4] = { (rows + h) * w + h, h, cols + h, 0 };
+
+    for (int side = 0; side < 4; side++) {
+        int position = 0;
+        MPI_Pack(&out[from[side]], 1, types[side], buffer.data(), (int)buffer.size(), &position, block.comm);
+        position = 0;
+        MPI_Unpack(buffer.data(), (int)buffer.size(), &position, &out[to[side]], 1, types[side], block.comm);
+    }
+}
+
+/// <summary>Sweeps the block while the outer rows and columns are sent, as the solvers do with OVERLAP.</summary>
+static void Overlapped(const Block& block, double* in, double* out, std::vector<char>&) {
+    Distributed::RelaxOverlapped(block, in, out);
+}
+
+/// <summary>Picks the width of the whole matrix such that the two matrices of every process reside in the L2 cache,
+/// or are much larger than the last level cache.</summary>
+static size_t GetWidth(bool dram, int worldSize) {
+    size_t bytes = Tiling::CacheSize() / 2;
+    if (dram) {
+        long size = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+        size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+        bytes = DRAM_FACTOR * (size > 0 ? (size_t)size : 32 * 1024 * 1024);
+    }
+
+    return (size_t)sqrt(bytes * worldSize / (2.0 * sizeof(double)));
+}
+
+/// <summary>Times HALO_STEPS runs of a path, alternating between two matrices.</summary>
+/// <returns>The time in milliseconds of the slowest process.</returns>
+static double Time(Path path, const Block& block, double* a, double* b, std::vector<char>& buffer) {
+    MPI_Barrier(block.comm);
+    double start = MPI_Wtime();
+    for (int s = 0; s < HALO_STEPS; s++) {
+        if (s % 2 == 0) {
+            path(block, a, b, buffer);
+        } else {
+            path(block, b, a, buffer);
+        }
+    }
+    double ms = (MPI_Wtime() - start) * 1000.0;
+
+    double slowest;
+    MPI_Allreduce(&ms, &slowest, 1, MPI_DOUBLE, MPI_MAX, block.comm);
+    return slowest;
+}
+
+/// <summary>Times the halo exchange of the solvers on its own, with a fixed number of exchanges on blocks that reside
+/// in the L2 cache and on ones that reside in memory. Relax is the sweep without an exchange, so Overlapped minus Relax
+/// is the part of the exchange that is not hidden. Run it with mpirun, results are appended to halo.csv.</summary>
+int main(int argc, char** argv) {
+    Distributed::Init(&argc, &argv);
+
+    // the processes on a node pin their threads to different cores
+    Affinity::Pin(Distributed::LocalRank() * Affinity::Threads());
+
+    int rank, worldSize;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &worldSize);
+
+    std::ofstream file;
+    if (rank == 0) {
+        file = Shared::OpenFile("halo", "Path,Resident,Cores,N,Steps,Time,Min,Bytes");
+    }
+
+    const char* names[4] = { "relax", "sendrecv", "pack", "overlapped" };
+    const Path paths[4] = { Relax, SendRecv, Pack, Overlapped };
+    for (bool dram : { false, true }) {
+        size_t n = GetWidth(dram, worldSize);
+        Block block = Distributed::CreateBlock(n, 1);
+        double* a = Shared::CreateMatrix(block.size);
+        double* b = Shared::CreateMatrix(block.size);
+
+        int rowBytes, columnBytes;
+        MPI_Pack_size(1, block.row, block.comm, &rowBytes);
+        MPI_Pack_size(1, block.column, block.comm, &columnBytes);
+        std::vector<char> buffer(std::max(rowBytes, columnBytes));
+        // bytes a process sends every exchange
+        size_t sent = 2 * (block.cols + block.rows + 2) * sizeof(double);
+
+        for (int p = 0; p < 4; p++) {
+            if (paths[p] == Overlapped && STENCIL.Diagonal()) { // the overlapped exchange leaves the corners out
+                continue;
+            }
+
+            // warm up the caches and the connections
+            Time(paths[p], block, a, b, buffer);
+
+            std::vector<double> times;
+            for (int r = 0; r < HALO_REPEATS; r++) {
+                times.push_back(Time(paths[p], block, a, b, buffer));
+            }
+            std::sort(times.begin(), times.end());
+
+            if (rank == 0) {
+                double median = times[HALO_REPEATS / 2];
+                file << names[p] << ","
+                     << (dram ? "memory" : "cache") << ","
+                     << worldSize << ","
+                     << n << ","
+                     << HALO_STEPS << ","
+                     << median << ","
+                     << times[0] << ","
+                     << sent << std::endl;
+                printf("%-10s %-6s Cores=%d N=%zu median=%.3fms min=%.3fms\n",
+                       names[p], dram ? "memory" : "cache", worldSize, n, median, times[0]);
+            }
+        }
+
+        Shared::FreeMatrix(a);
+        Shared::FreeMatrix(b);
+        Distributed::FreeBlock(block);
+    }
+
+    if (rank == 0) {
+        file.close();
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "Shared.h"
+#include "Simd.h"
+#include "Tiling.h"
+#include "Affinity.h"
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+// number of sweeps that are timed together, a fixed number instead of until the matrix is stable
+#define KERNEL_STEPS 20
+// number of times the sweeps are timed, the median and the fastest time are written
+#define KERNEL_REPEATS 10
+// the matrices that are resident in memory are this many times as large as the last level cache
+#define DRAM_FACTOR 4
+
+/// <summary>A kernel that sweeps a whole n*n matrix once.</summary>
+/// <returns>The partial norm of the change, 0 for a kernel that does not compute it.</returns>
+typedef double (*Sweep)(double* in, double* out, size_t n);
+
+/// <summary>A kernel of the suite.</summary>
+struct KernelInfo {
+    const char* name;
+    Sweep sweep;
+    size_t bytes;   // bytes a point moves to and from memory at least: every array it reads, written ones twice
+};
+
+/// <summary>Sweeps the inner rows with a row kernel of Simd, as Jacobi::Relax does.</summary>
+template <Simd::RowKernel K>
+static double Rows(double* in, double* out, size_t n) {
+    double norm = 0.0;
+    #pragma omp parallel for schedule(static) reduction(NORM_REDUCTION : norm)
+    for (size_t y = 1; y < n - 1; y++) {
+        norm = Shared::Combine(norm, K(in, out, n, y, 1, n - 1));
+    }
+
+    return norm;
+}
+
+/// <summary>Sweeps the matrix in cache-sized tiles.</summary>
+static double Tiled(double* in, double* out, size_t n) {
+    return Tiling::Relax(in, out, n, n, Tiling::GetTile(n, n));
+}
+
+/// <summary>Sweeps the matrix as a single vector with the 3-point stencil, as relax of Project01 does.</summary>
+static double Line(double* in, double* out, size_t n) {
+    #pragma omp parallel for simd schedule(static)
+    for (size_t i = 1; i < n * n - 1; i++) {
+        out[i] = Kernel<Stencils::Line>::Apply(in, 0, i);
+    }
+
+    return 0.0;
+}
+
+/// <summary>Checks the change of the whole matrix on its own, as isStable of Project01 and the roll back of
+/// CHECK_EVERY do, instead of while sweeping.</summary>
+static double Stable(double* in, double* out, size_t n) {
+    double norm = 0.0;
+    #pragma omp parallel for simd schedule(static) reduction(NORM_REDUCTION : norm)
+    for (size_t i = 0; i < n * n; i++) {
+        norm = Shared::Accumulate(norm, in[i] - out[i]);
+    }
+
+    return norm;
+}
+
+/// <summary>The kernels this CPU supports.</summary>
+static std::vector<KernelInfo> Kernels() {
+    std::vector<KernelInfo> kernels = {
+        { "scalar", Rows<Simd::DiffuseRowScalar>, 3 * sizeof(double) },
+        { "simd", Rows<Simd::DiffuseRow>, 3 * sizeof(double) },
+        { "tiled", Tiled, 3 * sizeof(double) },
+        { "line", Line, 3 * sizeof(double) },
+        { "stable", Stable, 2 * sizeof(double) },
+    };
+
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back({ "avx2", Rows<Simd::DiffuseRowAvx2>, 3 * sizeof(double) });
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        kernels.push_back({ "avx512", Rows<Simd::DiffuseRowAvx512>, 3 * sizeof(double) });
+    }
+#endif
+    return kernels;
+}
+
+/// <summary>Picks the width of the matrices that reside in the cache or in memory.</summary>
+/// <param name="dram">Whether both matrices should be much larger than the last level cache,
+/// instead of filling half the L2 cache together.</param>
+static size_t GetWidth(bool dram) {
+    size_t bytes = Tiling::CacheSize() / 2;
+    if (dram) {
+        long size = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+        size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+        bytes = DRAM_FACTOR * (size > 0 ? (size_t)size : 32 * 1024 * 1024);
+    }
+
+    return (size_t)sqrt(bytes / (2.0 * sizeof(double)));
+}
+
+/// <summary>Times KERNEL_STEPS sweeps of a kernel, alternating between two matrices.</summary>
+/// <returns>The time in milliseconds.</returns>
+static double Time(Sweep sweep, double* a, double* b, size_t n) {
+    double start = Shared::Now();
+    for (int s = 0; s < KERNEL_STEPS; s++) {
+        if (s % 2 == 0) {
+            sweep(a, b, n);
+        } else {
+            sweep(b, a, n);
+        }
+    }
+    return Shared::Now() - start;
+}
+
+/// <summary>Times every kernel on its own with a fixed number of sweeps, on matrices that reside in the L2 cache
+/// and on ones that reside in memory, so a change to a single kernel shows up without the allocation,
+/// convergence and output of a whole run. PointNs is the fastest time of relaxing a single point,
+/// GBS the bandwidth the fastest sweeps reach with the bytes a point moves at least.</summary>
+int main() {
+    Affinity::Pin();
+    std::ofstream file = Shared::OpenFile("kernels", "Kernel,Resident,N,Threads,Steps,Time,Min,PointNs,GBS");
+
+    for (bool dram : { false, true }) {
+        size_t n = GetWidth(dram);
+        double* a = Shared::CreateMatrix(n * n, n / 2, HEAT);
+        double* b = Shared::CreateMatrix(n * n, n / 2, HEAT);
+
+        for (const KernelInfo& kernel : Kernels()) {
+            // warm up the caches and the page tables
+            Time(kernel.sweep, a, b, n);
+
+            std::vector<double> times;
+            for (int r = 0; r < KERNEL_REPEATS; r++) {
+                times.push_back(Time(kernel.sweep, a, b, n));
+            }
+            std::sort(times.begin(), times.end());
+
+            double median = times[KERNEL_REPEATS / 2];
+            double points = (double)KERNEL_STEPS * n * n;
+            double pointNs = times[0] * 1e6 / points;
+            double gbs = points * kernel.bytes / times[0] / 1e6;
+            file << kernel.name << ","
+                 << (dram ? "memory" : "cache") << ","
+                 << n << ","
+                 << Affinity::Threads() << ","
+                 << KERNEL_STEPS << ","
+                 << median << ","
+                 << times[0] << ","
+                 << pointNs << ","
+                 << gbs << std::endl;
+            printf("%-8s %-6s N=%zu median=%.3fms min=%.3fms point=%.3fns %.2fGB/s\n",
+                   kernel.name, dram ? "memory" : "cache", n, median, times[0], pointNs, gbs);
+        }
+
+        Shared::FreeMatrix(a);
+        Shared::FreeMatrix(b);
+    }
+
+    file.close();
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "Shared.h"
+#include "Jacobi.h"
+#include "Precision.h"
+#include "Affinity.h"
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <pmmintrin.h>
+#endif
+
+/// <summary>Relaxes a matrix until it is stable with storage type T and compute type C, like Relax.cpp.</summary>
+/// <param name="n">The width of the matrix.</param>
+/// <param name="iterations">The number of iterations that were needed.</param>
+/// <param name="result">Set to the resulting matrix, widened to doubles.</param>
+/// <returns>The time it took in milliseconds.</returns>
+template <typename T, typename C>
+static int Time(size_t n, int& iterations, std::vector<double>& result) {
+    double start = Shared::Now();
+
+    T* saved = Shared::CreateMatrix<T>(n * n, n / 2, HEAT);
+    T* in = Shared::CreateMatrix<T>(n * n, n / 2, HEAT);
+    T* out = Shared::CreateMatrix<T>(n * n, n / 2, HEAT);
+    T* last;
+    Checkpoint checkpoint;
+    Checkpoints::Create(checkpoint, "precision", n, HEAT, EPS, false);
+    iterations = Jacobi::Iterate<T, C>(saved, in, out, n, n / 2, EPS, false, checkpoint, last);
+    Checkpoints::Finish(checkpoint);
+
+    int ms = (int)(Shared::Now() - start);
+
+    result.resize(n * n);
+    for (size_t i = 0; i < n * n; i++) {
+        result[i] = (double)C(last[i]);
+    }
+
+    Shared::FreeMatrix(saved);
+    Shared::FreeMatrix(in);
+    Shared::FreeMatrix(out);
+    return ms;
+}
+
+/// <summary>Solves with storage type T and compute type C and compares the result with the double baseline.</summary>
+/// <param name="file">The file to write to.</param>
+/// <param name="n">The width of the matrix.</param>
+/// <param name="baseline">The resulting matrix of the double baseline.</param>
+/// <param name="baselineTime">The time of the double baseline in milliseconds.</param>
+template <typename T, typename C>
+static void Compare(std::ofstream& file, size_t n, const std::vector<double>& baseline, int baselineTime) {
+    int iterations;
+    std::vector<double> result;
+    int ms = Time<T, C>(n, iterations, result);
+
+    double error = 0.0;
+    for (size_t i = 0; i < n * n; i++) {
+        error = fmax(error, fabs(result[i] - baseline[i]));
+    }
+
+    double speedup = ms > 0 ? (double)baselineTime / ms : 1.0;
+    file << n << ","
+         << (int)(n * n * sizeof(T) / (1024 * 1024)) << ","
+         << TypeName<T>::value << ","
+         << TypeName<C>::value << ","
+         << iterations << ","
+         << ms << ","
+         << speedup << ","
+         << error << std::endl;
+    printf("N=%zu %s/%s iterations=%d time=%dms speedup=%.2f error=%g\n",
+           n, TypeName<T>::value, TypeName<C>::value, iterations, ms, speedup, error);
+}
+
+/// <summary>Compares storage and compute types for the same sizes as Relax.cpp.
+/// The error is the largest absolute difference of the resulting matrix with the double baseline.
+/// Build with -fopenmp or -fopenmp-simd, so the norm of a row is vectorised.</summary>
+int main() {
+#if defined(__x86_64__) || defined(__i386__)
+    // far from the heat the values of a float underflow, and denormal arithmetic is many times slower
+    _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+    _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+#endif
+
+    Affinity::Pin();
+    std::ofstream file = Shared::OpenFile("precision", "N,Size,Storage,Compute,Iterations,Time,Speedup,Error");
+
+    for (int i = 1; i <= STEPS; i++) {
+        size_t n = i * N;
+        for (int r = 0; r < REPEATS; r++) {
+            int iterations;
+            std::vector<double> baseline;
+            int baselineTime = Time<double, double>(n, iterations, baseline);
+
+            Compare<double, double>(file, n, baseline, baselineTime);
+            Compare<float, float>(file, n, baseline, baselineTime);
+            Compare<float, double>(file, n, baseline, baselineTime);
+            Compare<bfloat16, float>(file, n, baseline, baselineTime);
+            Compare<bfloat16, double>(file, n, baseline, baselineTime);
+        }
+    }
+
+    file.close();
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "Shared.h"
+#include "Tiling.h"
+#include "Affinity.h"
+
+/// <summary>Relaxes a matrix until it is stable.</summary>
+/// <param name="n">The width of the matrix.</param>
+/// <param name="tile">The shape of a tile.</param>
+/// <param name="iterations">The number of iterations that were needed.</param>
+/// <returns>The time it took in milliseconds.</returns>
+static int Time(size_t n, Tiling::Tile tile, int& iterations) {
+    double start = Shared::Now();
+
+    iterations = 1;
+    double* in = Shared::CreateMatrix(n * n, n / 2, HEAT);
+    double* out = Shared::CreateMatrix(n * n, n / 2, HEAT);
+    double* tmp;
+
+    while (!Shared::IsStable(Tiling::Relax(in, out, n, n, tile), EPS)) {
+        tmp = in;
+        in = out;
+        out = tmp;
+        iterations++;
+    }
+
+    int ms = (int)(Shared::Now() - start);
+    Shared::FreeMatrix(in);
+    Shared::FreeMatrix(out);
+
+    return ms;
+}
+
+/// <summary>Compares the row by row sweep with the tiled sweep for the same sizes as Relax.cpp.</summary>
+int main() {
+    Affinity::Pin();
+    std::ofstream file = Shared::OpenFile("tiling", "N,Size,TileWidth,TileHeight,Iterations,RowTime,TiledTime");
+
+    for (int i = 1; i <= STEPS; i++) {
+        size_t n = i * N;
+        Tiling::Tile rows = { n - 2, n - 2 };
+        Tiling::Tile tile = Tiling::GetTile(n, n);
+
+        for (int r = 0; r < REPEATS; r++) {
+            int rowIterations, tiledIterations;
+            int rowTime = Time(n, rows, rowIterations);
+            int tiledTime = Time(n, tile, tiledIterations);
+
+            if (rowIterations != tiledIterations) {
+                printf("Iterations differ for N=%zu: %d rows, %d tiled.\n", n, rowIterations, tiledIterations);
+                return 1;
+            }
+
+            file << n << ","
+                 << (int)(n * n * sizeof(double) / (1024 * 1024)) << ","
+                 << tile.width << ","
+                 << tile.height << ","
+                 << rowIterations << ","
+                 << rowTime << ","
+                 << tiledTime << std::endl;
+            printf("N=%zu tile=%zux%zu rows=%dms tiled=%dms\n", n, tile.width, tile.height, rowTime, tiledTime);
+        }
+    }
+
+    file.close();
+    return 0;
+}
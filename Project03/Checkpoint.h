@@ -0,0 +1,261 @@
+#pragma once
+
+#include "Shared.h"
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// write a checkpoint every CHECKPOINT_ITERATIONS iterations, 0 disables it
+#define CHECKPOINT_ITERATIONS 0
+// write a checkpoint every CHECKPOINT_SECONDS seconds, 0 disables it
+#define CHECKPOINT_SECONDS 0
+// directory of the checkpoint files
+#define CHECKPOINT_PATH "."
+// continue from the checkpoint of a run with the same parameters, if there is one
+#define RESTART true
+
+/// <summary>The header of a checkpoint file, followed by the whole n*n matrix row by row in doubles.
+/// The layout does not depend on the number of processes or the type the matrix is stored in,
+/// so any run can continue from any checkpoint.</summary>
+struct CheckpointHeader {
+    char magic[8];          // "RELAXCKP"
+    uint32_t version;
+    uint32_t norm;          // NORM of the run
+    uint64_t n;
+    double heat;
+    double eps;
+    uint64_t iteration;     // number of iterations the matrix holds
+    uint64_t stencil;       // fingerprint of STENCIL, see Checkpoints::Fingerprint
+    char reserved[8];       // pads the header to a cache line, so the matrix is aligned in a mapped file
+};
+
+/// <summary>The checkpoints of a single run.</summary>
+struct Checkpoint {
+    std::string path;
+    size_t n;
+    double heat;
+    double eps;
+    bool restart;                                           // whether the run may continue from an existing checkpoint
+    int iteration;                                          // iteration of the last checkpoint
+    std::chrono::steady_clock::time_point time;             // time of the last checkpoint
+    std::thread writer;                                     // writes the last checkpoint in the background
+    std::vector<double> snapshot;                           // copy of the matrix the writer writes
+};
+
+class Checkpoints {
+public:
+    static_assert(sizeof(CheckpointHeader) == 64, "The matrix of a checkpoint starts at the second cache line.");
+
+    /// <summary>Prepares the checkpoints of a run.</summary>
+    /// <param name="checkpoint">The checkpoints to prepare.</param>
+    /// <param name="name">The name of the file in CHECKPOINT_PATH.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="heat">The heat value.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <param name="restart">Whether the run may continue from an existing checkpoint, false for runs that are timed.</param>
+    inline static void Create(Checkpoint& checkpoint, const std::string name, size_t n, double heat, double eps, bool restart = RESTART) {
+        checkpoint.path = std::string(CHECKPOINT_PATH) + "/" + name + "_" + std::to_string(n) + ".ckpt";
+        checkpoint.n = n;
+        checkpoint.heat = heat;
+        checkpoint.eps = eps;
+        checkpoint.restart = restart;
+        checkpoint.iteration = 0;
+        checkpoint.time = std::chrono::steady_clock::now();
+    }
+
+    /// <summary>Fills in the header of a checkpoint.</summary>
+    inline static CheckpointHeader Header(const Checkpoint& checkpoint, int iteration) {
+        CheckpointHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "RELAXCKP", 8);
+        header.version = 1;
+        header.norm = NORM;
+        header.n = checkpoint.n;
+        header.heat = checkpoint.heat;
+        header.eps = checkpoint.eps;
+        header.iteration = iteration;
+        header.stencil = Fingerprint();
+        return header;
+    }
+
+    /// <summary>Hashes the offsets and weights of STENCIL, so a run never continues from one with another stencil.</summary>
+    inline static uint64_t Fingerprint() {
+        uint64_t hash = 14695981039346656037ull;
+        auto add = [&hash](const void* data, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                hash = (hash ^ ((const unsigned char*)data)[i]) * 1099511628211ull;
+            }
+        };
+
+        for (size_t p = 0; p < STENCIL.points; p++) {
+            add(&STENCIL.dy[p], sizeof(int));
+            add(&STENCIL.dx[p], sizeof(int));
+            add(&STENCIL.w[p], sizeof(double));
+        }
+        return hash;
+    }
+
+    /// <summary>Checks whether a checkpoint should be written after an iteration.</summary>
+    inline static bool Due(const Checkpoint& checkpoint, int iteration) {
+        if (CHECKPOINT_ITERATIONS > 0 && iteration - checkpoint.iteration >= CHECKPOINT_ITERATIONS) {
+            return true;
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - checkpoint.time;
+        return CHECKPOINT_SECONDS > 0 && elapsed >= std::chrono::seconds(CHECKPOINT_SECONDS);
+    }
+
+    /// <summary>Copies a part of the matrix of the checkpoint of the run into a local matrix, by mapping the file.</summary>
+    /// <param name="checkpoint">The checkpoints of the run.</param>
+    /// <param name="m">The local matrix, points outside the whole matrix are left untouched.</param>
+    /// <param name="width">The width of the local matrix.</param>
+    /// <param name="height">The height of the local matrix.</param>
+    /// <param name="y0">The global row of the first local row, which may lie outside the matrix.</param>
+    /// <param name="x0">The global column of the first local column, which may lie outside the matrix.</param>
+    /// <returns>The iteration to continue from, 0 if there is no checkpoint of a run with the same parameters.</returns>
+    template <typename T>
+    inline static int Restart(Checkpoint& checkpoint, T* m, size_t width, size_t height, long y0, long x0) {
+        const CheckpointHeader* header = Map(checkpoint, true);
+        if (header == NULL) {
+            return 0;
+        }
+
+        Copy(checkpoint, header, m, width, height, y0, x0);
+        checkpoint.iteration = (int)header->iteration;
+        Unmap(checkpoint, header);
+        return checkpoint.iteration;
+    }
+
+    /// <summary>Maps the checkpoint of the run, if the run may restart and there is one of a run with the same parameters.</summary>
+    /// <param name="checkpoint">The checkpoints of the run.</param>
+    /// <param name="report">Whether to print why a checkpoint is ignored.</param>
+    /// <returns>The mapped file, which starts with its header, NULL if there is no checkpoint to continue from.</returns>
+    inline static const CheckpointHeader* Map(const Checkpoint& checkpoint, bool report) {
+        if (!checkpoint.restart) {
+            return NULL;
+        }
+
+        int fd = open(checkpoint.path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return NULL;
+        }
+
+        size_t size = MappedSize(checkpoint);
+        struct stat info;
+        void* data = fstat(fd, &info) == 0 && (size_t)info.st_size == size
+                   ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (data == MAP_FAILED) {
+            if (report) {
+                printf("Ignoring checkpoint '%s' of another size.\n", checkpoint.path.c_str());
+            }
+            return NULL;
+        }
+
+        const CheckpointHeader* header = (const CheckpointHeader*)data;
+        CheckpointHeader expected = Header(checkpoint, 0);
+        expected.iteration = header->iteration;
+        if (memcmp(header, &expected, sizeof(expected)) != 0) {
+            if (report) {
+                printf("Ignoring checkpoint '%s' of a run with other parameters.\n", checkpoint.path.c_str());
+            }
+            munmap(data, size);
+            return NULL;
+        }
+
+        return header;
+    }
+
+    /// <summary>Copies a part of the matrix of a mapped checkpoint into a local matrix, rounded to the type it is stored in.</summary>
+    /// <param name="checkpoint">The checkpoints of the run.</param>
+    /// <param name="header">The mapped checkpoint, see Map.</param>
+    /// <param name="m">The local matrix, points outside the whole matrix are left untouched.</param>
+    /// <param name="width">The width of the local matrix.</param>
+    /// <param name="height">The height of the local matrix.</param>
+    /// <param name="y0">The global row of the first local row, which may lie outside the matrix.</param>
+    /// <param name="x0">The global column of the first local column, which may lie outside the matrix.</param>
+    template <typename T>
+    inline static void Copy(const Checkpoint& checkpoint, const CheckpointHeader* header, T* m,
+                            size_t width, size_t height, long y0, long x0) {
+        size_t n = checkpoint.n;
+        const double* global = (const double*)((const char*)header + sizeof(CheckpointHeader));
+        for (size_t ly = 0; ly < height; ly++) {
+            long y = y0 + (long)ly;
+            if (y < 0 || y >= (long)n) {
+                continue;
+            }
+
+            long first = x0 < 0 ? -x0 : 0;
+            long last = x0 + (long)width > (long)n ? (long)n - x0 : (long)width;
+            for (long lx = first; lx < last; lx++) {
+                m[ly * width + lx] = T(global[y * n + x0 + lx]);
+            }
+        }
+    }
+
+    /// <summary>Unmaps a checkpoint of Map.</summary>
+    inline static void Unmap(const Checkpoint& checkpoint, const CheckpointHeader* header) {
+        if (header != NULL) {
+            munmap((void*)header, MappedSize(checkpoint));
+        }
+    }
+
+    /// <summary>Starts writing a checkpoint of the whole matrix in the background, after the previous one is written.
+    /// The file is written under a temporary name and renamed when complete, so a killed run leaves a valid checkpoint.</summary>
+    /// <param name="checkpoint">The checkpoints of the run.</param>
+    /// <param name="m">The matrix, which may change as soon as this returns, widened to doubles.</param>
+    /// <param name="iteration">The number of iterations the matrix holds.</param>
+    template <typename T>
+    inline static void Write(Checkpoint& checkpoint, const T* m, int iteration) {
+        Wait(checkpoint);
+        checkpoint.snapshot.assign(m, m + checkpoint.n * checkpoint.n);
+        checkpoint.iteration = iteration;
+        checkpoint.time = std::chrono::steady_clock::now();
+
+        CheckpointHeader header = Header(checkpoint, iteration);
+        checkpoint.writer = std::thread([&checkpoint, header]() {
+            std::string temporary = checkpoint.path + ".tmp";
+            FILE* file = fopen(temporary.c_str(), "wb");
+            if (file == NULL) {
+                printf("Could not write checkpoint '%s'.\n", temporary.c_str());
+                return;
+            }
+
+            bool written = fwrite(&header, sizeof(header), 1, file) == 1
+                        && fwrite(checkpoint.snapshot.data(), sizeof(double), checkpoint.snapshot.size(), file) == checkpoint.snapshot.size()
+                        && fflush(file) == 0 && fsync(fileno(file)) == 0;
+            fclose(file);
+            if (written) {
+                rename(temporary.c_str(), checkpoint.path.c_str());
+            }
+        });
+    }
+
+    /// <summary>Waits until the last checkpoint is written.</summary>
+    inline static void Wait(Checkpoint& checkpoint) {
+        if (checkpoint.writer.joinable()) {
+            checkpoint.writer.join();
+        }
+    }
+
+    /// <summary>Waits until the last checkpoint is written and removes it, as the run is complete.
+    /// Also removes what a killed run may have left of a checkpoint it was writing.</summary>
+    inline static void Finish(Checkpoint& checkpoint) {
+        Wait(checkpoint);
+        remove(checkpoint.path.c_str());
+        remove((checkpoint.path + ".tmp").c_str());
+    }
+
+private:
+    /// <summary>The size of a checkpoint file, its header and the whole matrix.</summary>
+    inline static size_t MappedSize(const Checkpoint& checkpoint) {
+        return sizeof(CheckpointHeader) + checkpoint.n * checkpoint.n * sizeof(double);
+    }
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <vector>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// count cycles, instructions and last level cache misses of a run with perf_event_open,
+// which are written as extra columns after the ones of Shared::WriteInfo
+#define COUNTERS false
+// bytes moved between memory and the last level cache by a single miss
+#define CACHE_LINE 64
+// names of the columns of Counters::Write
+#define COUNTER_COLUMNS ",Threads,CPUCycles,Instructions,Misses,GFLOPS,GBS,MemoryGBS"
+
+/// <summary>The hardware counters of a run summed over all threads, -1 for an event the machine or kernel does not count.
+/// Flops and bytes are the work the run does according to its stencil, 0 if it is not known.</summary>
+struct CounterValues {
+    long long cycles = -1;
+    long long instructions = -1;
+    long long misses = -1;      // last level cache misses, each moving CACHE_LINE bytes between the cache and memory
+    double flops = 0.0;         // floating point operations, see Stencil::Flops
+    double bytes = 0.0;         // bytes that have to move between the cache and memory at least
+};
+
+/// <summary>Counts hardware events with perf_event_open. A counter only follows the thread that opens it,
+/// and OpenMP keeps its threads between parallel regions, so every thread opens its own counters.</summary>
+class Counters {
+public:
+    /// <summary>Opens and starts the counters of every thread of the following parallel regions.</summary>
+    /// <returns>The file descriptors of every event of every thread, -1 for an event that could not be opened.</returns>
+    inline static std::vector<int> Start() {
+        std::vector<int> fds;
+        if (!COUNTERS) {
+            return fds;
+        }
+
+        #pragma omp parallel
+        {
+            #pragma omp single
+            fds.assign(Threads() * EVENTS, -1);
+
+            for (int e = 0; e < EVENTS; e++) {
+                fds[Thread() * EVENTS + e] = Open(e);
+            }
+        }
+        return fds;
+    }
+
+    /// <summary>Reads and closes the counters and adds up those of all threads.</summary>
+    /// <param name="fds">The file descriptors returned by Start, which are cleared.</param>
+    /// <param name="values">Set to the totals of the counters, the flops and bytes are left untouched.</param>
+    inline static void Stop(std::vector<int>& fds, CounterValues& values) {
+        values.cycles = values.instructions = values.misses = -1;
+        long long* totals[EVENTS] = { &values.cycles, &values.instructions, &values.misses };
+        for (size_t i = 0; i < fds.size(); i++) {
+            long long value;
+            if (fds[i] >= 0 && read(fds[i], &value, sizeof(value)) == sizeof(value)) {
+                long long& total = *totals[i % EVENTS];
+                total = total < 0 ? value : total + value;
+            }
+            if (fds[i] >= 0) {
+                close(fds[i]);
+            }
+        }
+
+        fds.clear();
+    }
+
+    /// <summary>Writes the counters and the throughput derived from them as extra columns: the OpenMP threads of
+    /// the process, which the counters are summed over, cycles, instructions, misses, GFLOP/s from the flops of the stencil, GB/s from the bytes the stencil has
+    /// to move, and GB/s from the misses that actually reached memory. Unknown values are written as -1.</summary>
+    /// <param name="ms">The time of the run in milliseconds.</param>
+    inline static void Write(std::ofstream& file, const CounterValues& values, int ms) {
+        double seconds = ms > 0 ? ms / 1000.0 : -1.0;
+        file << "," << MaxThreads()
+             << "," << values.cycles
+             << "," << values.instructions
+             << "," << values.misses
+             << "," << (values.flops > 0 && seconds > 0 ? values.flops / seconds / 1e9 : -1.0)
+             << "," << (values.bytes > 0 && seconds > 0 ? values.bytes / seconds / 1e9 : -1.0)
+             << "," << (values.misses >= 0 && seconds > 0 ? values.misses * (double)CACHE_LINE / seconds / 1e9 : -1.0);
+    }
+
+private:
+    static const int EVENTS = 3;
+
+    inline static int Threads() {
+#ifdef _OPENMP
+        return omp_get_num_threads();
+#else
+        return 1;
+#endif
+    }
+
+    inline static int MaxThreads() {
+#ifdef _OPENMP
+        return omp_get_max_threads();
+#else
+        return 1;
+#endif
+    }
+
+    inline static int Thread() {
+#ifdef _OPENMP
+        return omp_get_thread_num();
+#else
+        return 0;
+#endif
+    }
+
+    /// <summary>Opens a counter of the calling thread in user space, which is allowed without privileges.</summary>
+    /// <param name="event">The index of the event: cycles, instructions or last level cache misses.</param>
+    /// <returns>The file descriptor, -1 if the event is not available.</returns>
+    inline static int Open(int event) {
+#ifdef __linux__
+        const unsigned long long configs[EVENTS] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+        };
+
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[event];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+        return -1;
+#endif
+    }
+};
@@ -0,0 +1,674 @@
+#pragma once
+
+#include "Shared.h"
+#include "Simd.h"
+#include "RedBlack.h"
+#include "Affinity.h"
+#include "Checkpoint.h"
+#include <mpi.h>
+#include <stdint.h>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// exchange the outer rows and columns with the neighbours while the inner points are relaxed,
+// only used with a halo of one point
+#define OVERLAP true
+// split the matrix into horizontal strips instead of a 2D grid of blocks
+#define STRIPS false
+// width of the halo, the halo is exchanged every GHOST iterations
+#define GHOST 1
+// reduce the norms of a window of iterations while the next window is relaxed
+#define ASYNC_REDUCE true
+
+/// <summary>The part of the matrix owned by a process in the cartesian process grid.
+/// The local matrix has a halo on every side for the values of the neighbours.</summary>
+struct Block {
+    MPI_Comm comm;
+    int rank;
+    int worldSize;
+    int dims[2];                  // number of processes along y and x
+    int coords[2];                // position of this process along y and x
+    int up, down, left, right;    // neighbouring ranks, MPI_PROC_NULL at the edges of the matrix
+    size_t halo;                  // width of the halo
+    size_t y0, x0;                // global position of the first owned point
+    size_t rows, cols;            // number of owned points along y and x
+    size_t width;                 // width of the local matrix
+    size_t size;                  // size of the local matrix
+    size_t first[2], last[2];     // local range [first, last) of owned points that are relaxed along y and x
+    MPI_Datatype row;             // the halo rows above or below the owned points
+    MPI_Datatype column;          // the halo columns left or right of the owned points, including the corners
+    MPI_Datatype innerColumn;     // the halo columns left or right of the owned points, excluding the corners
+};
+
+/// <summary>A reduction of the norms of a window of iterations, which may still be in flight.</summary>
+struct Reduction {
+    std::vector<double> local;    // norms of this process, the send buffer
+    std::vector<double> global;   // norms of all processes, the receive buffer
+    MPI_Request request;
+    int iterations;               // number of iterations before the window
+};
+
+/// <summary>A checkpoint that is written collectively, which may still be in flight.</summary>
+struct CheckpointWrite {
+    MPI_File file;          // MPI_FILE_NULL if no checkpoint is being written
+    MPI_Request request;
+};
+
+class Distributed {
+public:
+    /// <summary>Initialises MPI for the hybrid solvers, whose master thread communicates inside OpenMP parallel regions.
+    /// When MPI does not allow that, every process runs a single thread instead.</summary>
+    /// <returns>Whether a process may run more than one thread.</returns>
+    inline static bool Init(int* argc, char*** argv) {
+        int provided;
+        MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+        if (provided >= MPI_THREAD_FUNNELED) {
+            return true;
+        }
+
+#ifdef _OPENMP
+        omp_set_num_threads(1);
+#endif
+        int rank;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        if (rank == 0) {
+            printf("MPI does not support threads, every process runs a single thread.\n");
+        }
+        return false;
+    }
+
+    /// <summary>Splits a dimension of the matrix evenly, the last part gets the remainder.</summary>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="parts">The number of parts.</param>
+    /// <param name="index">The part to calculate.</param>
+    /// <param name="start">The first point of the part.</param>
+    /// <param name="count">The number of points in the part.</param>
+    inline static void Split(size_t n, int parts, int index, size_t& start, size_t& count) {
+        start = (n / parts) * index;
+        count = n / parts;
+        if (index == parts - 1) {
+            count += n % parts;
+        }
+    }
+
+    /// <summary>Calculates the rank of this process among the processes on the same node.</summary>
+    inline static int LocalRank() {
+        MPI_Comm node;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+        int rank;
+        MPI_Comm_rank(node, &rank);
+        MPI_Comm_free(&node);
+        return rank;
+    }
+
+    /// <summary>Creates the cartesian process grid and calculates the block of this process.
+    /// The shape of the grid is picked by MPI_Dims_create, unless STRIPS is set.</summary>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="halo">The width of the halo, smaller than the smallest block.</param>
+    /// <typeparam name="T">The type the matrix is stored in, the same as that of the solver.</typeparam>
+    /// <returns>The block of this process.</returns>
+    template <typename T = double>
+    inline static Block CreateBlock(size_t n, size_t halo = GHOST) {
+        Block block;
+        MPI_Comm_size(MPI_COMM_WORLD, &block.worldSize);
+
+        block.dims[0] = STRIPS ? block.worldSize : 0;
+        block.dims[1] = STRIPS ? 1 : 0;
+        MPI_Dims_create(block.worldSize, 2, block.dims);
+
+        int periods[2] = { 0, 0 };
+        MPI_Cart_create(MPI_COMM_WORLD, 2, block.dims, periods, 1, &block.comm);
+        MPI_Comm_rank(block.comm, &block.rank);
+        MPI_Cart_coords(block.comm, block.rank, 2, block.coords);
+        MPI_Cart_shift(block.comm, 0, 1, &block.up, &block.down);
+        MPI_Cart_shift(block.comm, 1, 1, &block.left, &block.right);
+
+        Split(n, block.dims[0], block.coords[0], block.y0, block.rows);
+        Split(n, block.dims[1], block.coords[1], block.x0, block.cols);
+        block.halo = halo;
+        block.width = block.cols + 2 * halo;
+        block.size = (block.rows + 2 * halo) * block.width;
+
+        // the outer points of the whole matrix are never relaxed
+        block.first[0] = block.y0 == 0 ? halo + 1 : halo;
+        block.first[1] = block.x0 == 0 ? halo + 1 : halo;
+        block.last[0] = block.y0 + block.rows == n ? halo + block.rows - 1 : halo + block.rows;
+        block.last[1] = block.x0 + block.cols == n ? halo + block.cols - 1 : halo + block.cols;
+
+        MPI_Type_vector(halo, block.cols, block.width, PointType<T>(), &block.row);
+        MPI_Type_vector(block.rows + 2 * halo, halo, block.width, PointType<T>(), &block.column);
+        MPI_Type_vector(block.rows, halo, block.width, PointType<T>(), &block.innerColumn);
+        MPI_Type_commit(&block.row);
+        MPI_Type_commit(&block.column);
+        MPI_Type_commit(&block.innerColumn);
+        return block;
+    }
+
+    /// <summary>The MPI datatype of a point stored as T, whose bits are sent as they are.</summary>
+    template <typename T>
+    inline static MPI_Datatype PointType() {
+        if constexpr (std::is_same<T, double>::value) {
+            return MPI_DOUBLE;
+        } else if constexpr (std::is_same<T, float>::value) {
+            return MPI_FLOAT;
+        } else {
+            static_assert(sizeof(T) == sizeof(uint16_t), "a point is a double, a float or 16 bits");
+            return MPI_UINT16_T;
+        }
+    }
+
+    /// <summary>Frees the process grid and datatypes of a block.</summary>
+    inline static void FreeBlock(Block& block) {
+        MPI_Type_free(&block.row);
+        MPI_Type_free(&block.column);
+        MPI_Type_free(&block.innerColumn);
+        MPI_Comm_free(&block.comm);
+    }
+
+    /// <summary>Calculates the local index of the heat in the top row of the matrix.</summary>
+    /// <returns>The local index of the heat, -1 if this process does not own it.</returns>
+    inline static int GetHeatIndex(const Block& block, size_t n) {
+        size_t heat = n / 2;
+        if (block.y0 != 0 || heat < block.x0 || heat >= block.x0 + block.cols) {
+            return -1;
+        }
+
+        return (int)(block.halo * block.width + heat - block.x0 + block.halo);
+    }
+
+    /// <summary>Relaxes a rectangle of this process' matrix.</summary>
+    /// <param name="in">The original matrix.</param>
+    /// <param name="out">The resulting matrix.</param>
+    /// <param name="width">The width of the local matrix.</param>
+    /// <param name="y0">The first row to relax.</param>
+    /// <param name="y1">The row after the last one to relax.</param>
+    /// <param name="x0">The first column to relax.</param>
+    /// <param name="x1">The column after the last one to relax.</param>
+    /// <remarks>Inside a parallel region the rows are shared between the threads without a barrier,
+    /// and every thread returns the norm of its own rows only.</remarks>
+    /// <returns>The partial norm of the change of the rectangle, see Shared::Accumulate.</returns>
+    template <typename T, typename C = T>
+    inline static double RelaxRect(T* in, T* out, size_t width, size_t y0, size_t y1, size_t x0, size_t x1) {
+        double norm = 0.0;
+        #pragma omp for schedule(static) nowait
+        for (size_t y = y0; y < y1; y++) {
+            norm = Shared::Combine(norm, Simd::DiffuseRow<T, C>(in, out, width, y, x0, x1));
+        }
+
+        return norm;
+    }
+
+    /// <summary>Individual step of the 5-point stencil on the owned points.</summary>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="in">The original matrix.</param>
+    /// <param name="out">The resulting matrix.</param>
+    /// <returns>The partial norm of the change of this process' matrix, see Shared::Accumulate.</returns>
+    template <typename T = double, typename C = T>
+    inline static double Relax(const Block& block, T* in, T* out) {
+        double norm = 0.0;
+        #pragma omp parallel reduction(NORM_REDUCTION : norm)
+        norm = Shared::Combine(norm, RelaxRect<T, C>(in, out, block.width, block.first[0], block.last[0], block.first[1], block.last[1]));
+        return norm;
+    }
+
+    /// <summary>Individual step of the 5-point stencil on the owned points and a number of points into the halo
+    /// on every side with a neighbour, which redoes the work of the neighbour so the halo stays valid.</summary>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="in">The original matrix, valid up to one point further into the halo.</param>
+    /// <param name="out">The resulting matrix.</param>
+    /// <param name="extra">The number of points into the halo to relax.</param>
+    /// <returns>The partial norm of the change of the owned points only, see Shared::Accumulate.</returns>
+    template <typename T, typename C = T>
+    inline static double RelaxExtended(const Block& block, T* in, T* out, size_t extra) {
+        size_t y0 = block.up != MPI_PROC_NULL ? block.first[0] - extra : block.first[0];
+        size_t y1 = block.down != MPI_PROC_NULL ? block.last[0] + extra : block.last[0];
+        size_t x0 = block.left != MPI_PROC_NULL ? block.first[1] - extra : block.first[1];
+        size_t x1 = block.right != MPI_PROC_NULL ? block.last[1] + extra : block.last[1];
+
+        double norm = 0.0;
+        #pragma omp parallel for schedule(static) reduction(NORM_REDUCTION : norm)
+        for (size_t y = y0; y < y1; y++) {
+            if (y < block.first[0] || y >= block.last[0]) {
+                Simd::DiffuseRow<T, C>(in, out, block.width, y, x0, x1);
+                continue;
+            }
+
+            Simd::DiffuseRow<T, C>(in, out, block.width, y, x0, block.first[1]);
+            norm = Shared::Combine(norm, Simd::DiffuseRow<T, C>(in, out, block.width, y, block.first[1], block.last[1]));
+            Simd::DiffuseRow<T, C>(in, out, block.width, y, block.last[1], x1);
+        }
+
+        return norm;
+    }
+
+    /// <summary>Individual step of the 5-point stencil that relaxes the outer rows and columns first,
+    /// then sends them to the neighbours while the inner points are relaxed. Requires a halo of one point.
+    /// With OpenMP only the master thread communicates, as MPI_THREAD_FUNNELED allows,
+    /// and it joins the other threads on the inner points after posting the messages.</summary>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="in">The original matrix.</param>
+    /// <param name="out">The resulting matrix, including the halo received from the neighbours.</param>
+    /// <returns>The partial norm of the change of this process' matrix, see Shared::Accumulate.</returns>
+    template <typename T, typename C = T>
+    inline static double RelaxOverlapped(const Block& block, T* in, T* out) {
+        size_t w = block.width, rows = block.rows, cols = block.cols;
+        size_t y0 = block.first[0], y1 = block.last[0]; // rectangle that still has to be relaxed
+        size_t x0 = block.first[1], x1 = block.last[1];
+
+        // outer rows and columns that are sent, the inner rectangle is [iy0, iy1) x [ix0, ix1)
+        bool up = block.up != MPI_PROC_NULL;
+        bool down = block.down != MPI_PROC_NULL && y1 > y0 + up;
+        bool left = block.left != MPI_PROC_NULL && x1 > x0;
+        bool right = block.right != MPI_PROC_NULL && x1 > x0 + left;
+        size_t iy0 = y0 + up, iy1 = y1 - down;
+        size_t ix0 = x0 + left, ix1 = x1 - right;
+
+        double norm = 0.0;
+        MPI_Request requests[8];
+        #pragma omp parallel reduction(NORM_REDUCTION : norm)
+        {
+            if (up) {
+                norm = Shared::Combine(norm, RelaxRect<T, C>(in, out, w, y0, y0 + 1, x0, x1));
+            }
+            if (down) {
+                norm = Shared::Combine(norm, RelaxRect<T, C>(in, out, w, y1 - 1, y1, x0, x1));
+            }
+            if (left) {
+                norm = Shared::Combine(norm, RelaxRect<T, C>(in, out, w, iy0, iy1, x0, x0 + 1));
+            }
+            if (right) {
+                norm = Shared::Combine(norm, RelaxRect<T, C>(in, out, w, iy0, iy1, x1 - 1, x1));
+            }
+            #pragma omp barrier
+
+            // the tag is the direction the data travels in: up, down, left, right
+            #pragma omp master
+            {
+                MPI_Irecv(&out[1], 1, block.row, block.up, 1, block.comm, &requests[0]);
+                MPI_Irecv(&out[(rows + 1) * w + 1], 1, block.row, block.down, 0, block.comm, &requests[1]);
+                MPI_Irecv(&out[w], 1, block.innerColumn, block.left, 3, block.comm, &requests[2]);
+                MPI_Irecv(&out[w + cols + 1], 1, block.innerColumn, block.right, 2, block.comm, &requests[3]);
+                MPI_Isend(&out[w + 1], 1, block.row, block.up, 0, block.comm, &requests[4]);
+                MPI_Isend(&out[rows * w + 1], 1, block.row, block.down, 1, block.comm, &requests[5]);
+                MPI_Isend(&out[w + 1], 1, block.innerColumn, block.left, 2, block.comm, &requests[6]);
+                MPI_Isend(&out[w + cols], 1, block.innerColumn, block.right, 3, block.comm, &requests[7]);
+            }
+
+            norm = Shared::Combine(norm, RelaxRect<T, C>(in, out, w, iy0, iy1, ix0, ix1));
+
+            #pragma omp master
+            MPI_Waitall(8, requests, MPI_STATUSES_IGNORE);
+        }
+
+        return norm;
+    }
+
+    /// <summary>Updates neighbouring processes by sending them the outer rows and columns of this process' matrix.
+    /// Then this process updates its halo with the data received from its neighbours.
+    /// The rows are exchanged before the columns, so the corners of the halo are filled as well.</summary>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="out">The resulting matrix.</param>
+    template <typename T>
+    inline static void UpdateNeighbours(const Block& block, T* out) {
+        size_t w = block.width, h = block.halo, rows = block.rows, cols = block.cols;
+        MPI_Sendrecv(&out[h * w + h], 1, block.row, block.up, 0,
+                     &out[(rows + h) * w + h], 1, block.row, block.down, 0, block.comm, MPI_STATUS_IGNORE);
+        MPI_Sendrecv(&out[rows * w + h], 1, block.row, block.down, 1,
+                     &out[h], 1, block.row, block.up, 1, block.comm, MPI_STATUS_IGNORE);
+        MPI_Sendrecv(&out[h], 1, block.column, block.left, 2,
+                     &out[cols + h], 1, block.column, block.right, 2, block.comm, MPI_STATUS_IGNORE);
+        MPI_Sendrecv(&out[cols], 1, block.column, block.right, 3,
+                     &out[0], 1, block.column, block.left, 3, block.comm, MPI_STATUS_IGNORE);
+    }
+
+    /// <summary>Starts reducing the norms of a window of iterations over all processes.</summary>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="reduction">The reduction to start, which must not be in flight.</param>
+    /// <param name="norms">The norms of this process for every iteration of the window.</param>
+    /// <param name="iterations">The number of iterations before the window.</param>
+    inline static void StartReduction(const Block& block, Reduction& reduction, const std::vector<double>& norms, int iterations) {
+        reduction.local = norms;
+        reduction.global.resize(norms.size());
+        reduction.iterations = iterations;
+        MPI_Iallreduce(reduction.local.data(), reduction.global.data(), (int)norms.size(), MPI_DOUBLE,
+                       NORM == NORM_L2 ? MPI_SUM : MPI_MAX, block.comm, &reduction.request);
+    }
+
+    /// <summary>Waits for a reduction and finds the first stable iteration of its window.</summary>
+    /// <param name="reduction">The reduction to finish, nothing happens if it was never started.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <returns>The number of the first stable iteration, 0 if there is none.</returns>
+    inline static int FinishReduction(Reduction& reduction, double eps) {
+        if (reduction.request == MPI_REQUEST_NULL) {
+            return 0;
+        }
+
+        MPI_Wait(&reduction.request, MPI_STATUS_IGNORE);
+        for (size_t s = 0; s < reduction.global.size(); s++) {
+            if (Shared::IsStable(reduction.global[s], eps)) { // only when every process is stable we can stop
+                return reduction.iterations + (int)s + 1;
+            }
+        }
+
+        return 0;
+    }
+
+    /// <summary>Reduces the norms of a window of iterations. With ASYNC_REDUCE, the previous window is finished
+    /// instead and this one is left in flight, so every process can relax the next window in the meantime.
+    /// The norms of every iteration are kept, so the first stable iteration is still exact.</summary>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="reduction">The reduction of the previous window.</param>
+    /// <param name="norms">The norms of this process for every iteration of the window.</param>
+    /// <param name="iterations">The number of iterations before the window.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <returns>The number of the first stable iteration, 0 if there is none yet.</returns>
+    inline static int Reduce(const Block& block, Reduction& reduction, const std::vector<double>& norms, int iterations, double eps) {
+        if (!ASYNC_REDUCE) {
+            StartReduction(block, reduction, norms, iterations);
+            return FinishReduction(reduction, eps);
+        }
+
+        int stable = FinishReduction(reduction, eps);
+        if (stable == 0) {
+            StartReduction(block, reduction, norms, iterations);
+        }
+
+        return stable;
+    }
+
+    /// <summary>Relaxes the matrix until it is stable, exchanging the halo every iteration
+    /// while the inner points are relaxed. The norms are reduced every CHECK_EVERY iterations.
+    /// Requires a halo of one point.</summary>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="heat">The heat value to place.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <param name="checkpoint">The checkpoints of the run.</param>
+    /// <param name="write">The checkpoint that is being written.</param>
+    /// <returns>The number of iterations.</returns>
+    template <typename T, typename C = T>
+    inline static int SolveOverlapped(const Block& block, size_t n, double heat, double eps, Checkpoint& checkpoint, CheckpointWrite& write) {
+        T* in = Shared::CreateMatrix<T>(block.size, GetHeatIndex(block, n), heat);
+        T* out = Shared::CreateMatrix<T>(block.size, GetHeatIndex(block, n), heat);
+        T* tmp;
+
+        std::vector<double> norms(CHECK_EVERY);
+        Reduction reduction;
+        reduction.request = MPI_REQUEST_NULL;
+
+        int iterations = RestartCheckpoint(block, checkpoint, in), stable = 0;
+        while (stable == 0) {
+            for (int s = 0; s < CHECK_EVERY; s++) {
+                norms[s] = RelaxOverlapped<T, C>(block, in, out);
+
+                tmp = in;
+                in = out;
+                out = tmp;
+            }
+
+            stable = Reduce(block, reduction, norms, iterations, eps);
+            iterations += CHECK_EVERY;
+            if (stable == 0) {
+                stable = SaveCheckpoint(block, checkpoint, write, reduction, in, iterations, eps);
+            }
+        }
+
+        Shared::FreeMatrix(in);
+        Shared::FreeMatrix(out);
+        return stable;
+    }
+
+    /// <summary>Relaxes the matrix until it is stable, exchanging the halo once every halo-width iterations.
+    /// In between, every process relaxes one point less into its halo each iteration.
+    /// The norms of all these iterations are reduced at once, so the number of iterations is still exact.</summary>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="heat">The heat value to place.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <param name="checkpoint">The checkpoints of the run.</param>
+    /// <param name="write">The checkpoint that is being written.</param>
+    /// <returns>The number of iterations.</returns>
+    template <typename T, typename C = T>
+    inline static int SolveDeep(const Block& block, size_t n, double heat, double eps, Checkpoint& checkpoint, CheckpointWrite& write) {
+        int k = (int)block.halo;
+        T* saved = Shared::CreateMatrix<T>(block.size, GetHeatIndex(block, n), heat);
+        T* a = Shared::CreateMatrix<T>(block.size, GetHeatIndex(block, n), heat);
+        T* b = k > 1 ? Shared::CreateMatrix<T>(block.size, GetHeatIndex(block, n), heat) : NULL;
+        T* last = saved;
+
+        // every matrix needs the outer points of the whole matrix that lie in its halo, such as the heat
+        UpdateNeighbours(block, saved);
+        UpdateNeighbours(block, a);
+        if (b != NULL) {
+            UpdateNeighbours(block, b);
+        }
+
+        std::vector<double> norms(k);
+        Reduction reduction;
+        reduction.request = MPI_REQUEST_NULL;
+
+        // saved always holds the iteration the halo was last exchanged for
+        int iterations = RestartCheckpoint(block, checkpoint, saved), stable = 0;
+        while (stable == 0) {
+            T* in = saved;
+            for (int s = 1; s <= k; s++) {
+                last = s % 2 == 1 ? a : b;
+                norms[s - 1] = RelaxExtended<T, C>(block, in, last, k - s);
+                in = last;
+            }
+
+            stable = Reduce(block, reduction, norms, iterations, eps);
+            iterations += k;
+
+            UpdateNeighbours(block, last);
+            if (last == a) {
+                a = saved;
+            } else {
+                b = saved;
+            }
+            saved = last;
+
+            if (stable == 0) {
+                stable = SaveCheckpoint(block, checkpoint, write, reduction, saved, iterations, eps);
+            }
+        }
+
+        Shared::FreeMatrix(saved);
+        Shared::FreeMatrix(a);
+        Shared::FreeMatrix(b);
+        return stable;
+    }
+
+    /// <summary>Relaxes the matrix in place in red-black order until it is stable, exchanging the halo
+    /// after every half-sweep. The result is the same as that of RedBlack::Solve on the whole matrix.
+    /// The norms are reduced every CHECK_EVERY iterations.</summary>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="heat">The heat value to place.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <param name="checkpoint">The checkpoints of the run.</param>
+    /// <param name="write">The checkpoint that is being written.</param>
+    /// <returns>The number of iterations.</returns>
+    template <typename T, typename C = T>
+    inline static int SolveRedBlack(const Block& block, size_t n, double heat, double eps, Checkpoint& checkpoint, CheckpointWrite& write) {
+        T* m = Shared::CreateMatrix<T>(block.size, GetHeatIndex(block, n), heat);
+        UpdateNeighbours(block, m);
+        int iterations = RestartCheckpoint(block, checkpoint, m), stable = 0;
+
+        // the colours are of the global coordinates, so they match those of the neighbours
+        int red = (int)((RED + block.y0 + block.x0) % 2);
+        int black = 1 - red;
+
+        std::vector<double> norms(CHECK_EVERY);
+        Reduction reduction;
+        reduction.request = MPI_REQUEST_NULL;
+
+        while (stable == 0) {
+            for (int s = 0; s < CHECK_EVERY; s++) {
+                double norm = RedBlack::Relax<T, C>(m, block.width, block.first[0], block.last[0], block.first[1], block.last[1], red);
+                UpdateNeighbours(block, m);
+                norm = Shared::Combine(norm, RedBlack::Relax<T, C>(m, block.width, block.first[0], block.last[0], block.first[1], block.last[1], black));
+                UpdateNeighbours(block, m);
+                norms[s] = norm;
+            }
+
+            stable = Reduce(block, reduction, norms, iterations, eps);
+            iterations += CHECK_EVERY;
+            if (stable == 0) {
+                stable = SaveCheckpoint(block, checkpoint, write, reduction, m, iterations, eps);
+            }
+        }
+
+        Shared::FreeMatrix(m);
+        return stable;
+    }
+
+    /// <summary>Relaxes the matrix until it is stable, continuing from a checkpoint of the same run if there is one.</summary>
+    /// <typeparam name="T">The type the matrix is stored in, that of CreateBlock.</typeparam>
+    /// <typeparam name="C">The type the points are computed in.</typeparam>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="heat">The heat value to place.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <returns>The number of iterations.</returns>
+    template <typename T = double, typename C = T>
+    inline static int Solve(const Block& block, size_t n, double heat, double eps) {
+        Checkpoint checkpoint;
+        Checkpoints::Create(checkpoint, RED_BLACK ? "redblack" : "relax", n, heat, eps);
+        return Solve<T, C>(block, n, heat, eps, checkpoint);
+    }
+
+    /// <summary>Relaxes the matrix until it is stable, with the checkpoints of the caller, see Checkpoints::Create.</summary>
+    /// <param name="checkpoint">The checkpoints of the run, which are removed when it is complete.</param>
+    template <typename T = double, typename C = T>
+    inline static int Solve(const Block& block, size_t n, double heat, double eps, Checkpoint& checkpoint) {
+        CheckpointWrite write = { MPI_FILE_NULL, MPI_REQUEST_NULL };
+
+        int iterations;
+        if (RED_BLACK) {
+            iterations = SolveRedBlack<T, C>(block, n, heat, eps, checkpoint, write);
+        } else if (OVERLAP && block.halo == 1 && !STENCIL.Diagonal()) { // the overlapped exchange leaves the corners of the halo out
+            iterations = SolveOverlapped<T, C>(block, n, heat, eps, checkpoint, write);
+        } else {
+            iterations = SolveDeep<T, C>(block, n, heat, eps, checkpoint, write);
+        }
+
+        // the run is complete, so its checkpoint is of no use anymore
+        FinishCheckpoint(block, checkpoint, write);
+        if (block.rank == 0) {
+            Checkpoints::Finish(checkpoint);
+        }
+        return iterations;
+    }
+
+    /// <summary>Copies this process' part of the checkpoint of the run into its matrix, including the halo.
+    /// Every process opens the file on its own, so they only continue from it when all of them find the same iteration,
+    /// otherwise they all start over, instead of deadlocking in the reductions with different iterations.</summary>
+    /// <returns>The iteration to continue from, 0 if there is no checkpoint of a run with the same parameters.</returns>
+    template <typename T>
+    inline static int RestartCheckpoint(const Block& block, Checkpoint& checkpoint, T* m) {
+        const CheckpointHeader* header = Checkpoints::Map(checkpoint, block.rank == 0);
+
+        // the lowest and the negated highest iteration found, -1 for a process without a checkpoint
+        int found = header != NULL ? (int)header->iteration : -1;
+        int local[2] = { found, -found };
+        int global[2];
+        MPI_Allreduce(local, global, 2, MPI_INT, MPI_MIN, block.comm);
+
+        int iteration = 0;
+        if (global[0] >= 0 && global[0] == -global[1]) {
+            Checkpoints::Copy(checkpoint, header, m, block.width, block.rows + 2 * block.halo,
+                              (long)block.y0 - (long)block.halo, (long)block.x0 - (long)block.halo);
+            iteration = found;
+            checkpoint.iteration = found;
+        } else if (global[1] <= 0 && block.rank == 0) {
+            printf("Ignoring checkpoint '%s' that not every process can read.\n", checkpoint.path.c_str());
+        }
+
+        Checkpoints::Unmap(checkpoint, header);
+        return iteration;
+    }
+
+    /// <summary>Writes a checkpoint if one is due. The window of norms that is still in flight is finished first,
+    /// as a run that continues from the checkpoint would never check those iterations.</summary>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="checkpoint">The checkpoints of the run.</param>
+    /// <param name="write">The checkpoint that is being written.</param>
+    /// <param name="reduction">The reduction that may still be in flight.</param>
+    /// <param name="m">The matrix, with its halo up to date.</param>
+    /// <param name="iterations">The number of iterations the matrix holds.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <returns>The number of the first stable iteration of the finished window, 0 if there is none.</returns>
+    template <typename T>
+    inline static int SaveCheckpoint(const Block& block, Checkpoint& checkpoint, CheckpointWrite& write, Reduction& reduction,
+                                     const T* m, int iterations, double eps) {
+        // the clocks of the processes differ, so the first process decides when a checkpoint is due
+        int due = Checkpoints::Due(checkpoint, iterations);
+        if (CHECKPOINT_SECONDS > 0) {
+            MPI_Bcast(&due, 1, MPI_INT, 0, block.comm);
+        }
+        if (!due) {
+            return 0;
+        }
+
+        int stable = FinishReduction(reduction, eps);
+        if (stable == 0) {
+            StartCheckpoint(block, checkpoint, write, m, iterations);
+        }
+        return stable;
+    }
+
+    /// <summary>Starts writing the owned points of every process into a single checkpoint with collective MPI-IO,
+    /// after the previous checkpoint is written. The first process writes the header.</summary>
+    /// <param name="m">The matrix, which may change as soon as this returns, widened to doubles.</param>
+    /// <param name="iterations">The number of iterations the matrix holds.</param>
+    template <typename T>
+    inline static void StartCheckpoint(const Block& block, Checkpoint& checkpoint, CheckpointWrite& write, const T* m, int iterations) {
+        FinishCheckpoint(block, checkpoint, write);
+
+        checkpoint.snapshot.resize(block.rows * block.cols);
+        for (size_t y = 0; y < block.rows; y++) {
+            const T* row = &m[(y + block.halo) * block.width + block.halo];
+            std::copy(row, row + block.cols, &checkpoint.snapshot[y * block.cols]);
+        }
+        checkpoint.iteration = iterations;
+        checkpoint.time = std::chrono::steady_clock::now();
+
+        std::string temporary = checkpoint.path + ".tmp";
+        MPI_File_open(block.comm, temporary.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &write.file);
+        if (block.rank == 0) {
+            CheckpointHeader header = Checkpoints::Header(checkpoint, iterations);
+            MPI_File_write_at(write.file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE);
+        }
+
+        // the owned points of this process are a rectangle of the whole matrix in the file
+        int sizes[2] = { (int)checkpoint.n, (int)checkpoint.n };
+        int subsizes[2] = { (int)block.rows, (int)block.cols };
+        int starts[2] = { (int)block.y0, (int)block.x0 };
+        MPI_Datatype part;
+        MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_DOUBLE, &part);
+        MPI_Type_commit(&part);
+        MPI_File_set_view(write.file, sizeof(CheckpointHeader), MPI_DOUBLE, part, "native", MPI_INFO_NULL);
+        MPI_Type_free(&part);
+
+        MPI_File_iwrite_all(write.file, checkpoint.snapshot.data(), (int)checkpoint.snapshot.size(), MPI_DOUBLE, &write.request);
+    }
+
+    /// <summary>Waits until the checkpoint that is being written is complete, then moves it in place.</summary>
+    inline static void FinishCheckpoint(const Block& block, const Checkpoint& checkpoint, CheckpointWrite& write) {
+        if (write.file == MPI_FILE_NULL) {
+            return;
+        }
+
+        MPI_Wait(&write.request, MPI_STATUS_IGNORE);
+        MPI_File_close(&write.file);
+        if (block.rank == 0) {
+            rename((checkpoint.path + ".tmp").c_str(), checkpoint.path.c_str());
+        }
+    }
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Shared.h"
+#include "Volume.h"
+#include "Distributed.h"
+#include <mpi.h>
+
+/// <summary>The part of the volume owned by a process in the 3D cartesian process grid.
+/// The local volume has a halo of one point on every face for the values of the neighbours.</summary>
+struct Block3D {
+    MPI_Comm comm;
+    int rank;
+    int worldSize;
+    int dims[3];                  // number of processes along z, y and x
+    int coords[3];                // position of this process along z, y and x
+    int lower[3], upper[3];       // neighbouring ranks along z, y and x, MPI_PROC_NULL at the faces of the volume
+    size_t start[3];              // global position of the first owned point along z, y and x
+    size_t count[3];              // number of owned points along z, y and x
+    size_t width;                 // distance between two rows of the local volume
+    size_t plane;                 // distance between two planes of the local volume
+    size_t size;                  // size of the local volume
+    size_t first[3], last[3];     // local range [first, last) of owned points that are relaxed along z, y and x
+    MPI_Datatype face[3];         // the owned points of a face perpendicular to z, y and x
+};
+
+class Distributed3D {
+public:
+    /// <summary>Creates the 3D cartesian process grid and calculates the block of this process.</summary>
+    /// <param name="n">The width of the volume.</param>
+    /// <returns>The block of this process.</returns>
+    inline static Block3D CreateBlock(size_t n) {
+        Block3D block;
+        MPI_Comm_size(MPI_COMM_WORLD, &block.worldSize);
+
+        block.dims[0] = block.dims[1] = block.dims[2] = 0;
+        MPI_Dims_create(block.worldSize, 3, block.dims);
+
+        int periods[3] = { 0, 0, 0 };
+        MPI_Cart_create(MPI_COMM_WORLD, 3, block.dims, periods, 1, &block.comm);
+        MPI_Comm_rank(block.comm, &block.rank);
+        MPI_Cart_coords(block.comm, block.rank, 3, block.coords);
+
+        for (int d = 0; d < 3; d++) {
+            MPI_Cart_shift(block.comm, d, 1, &block.lower[d], &block.upper[d]);
+            Distributed::Split(n, block.dims[d], block.coords[d], block.start[d], block.count[d]);
+
+            // the outer points of the whole volume are never relaxed
+            block.first[d] = block.start[d] == 0 ? 2 : 1;
+            block.last[d] = block.start[d] + block.count[d] == n ? block.count[d] : block.count[d] + 1;
+        }
+
+        block.width = block.count[2] + 2;
+        block.plane = block.width * (block.count[1] + 2);
+        block.size = block.plane * (block.count[0] + 2);
+
+        // a face perpendicular to x is a column in every plane, so it is a vector of vectors
+        MPI_Datatype column;
+        MPI_Type_vector(block.count[1], 1, block.width, MPI_DOUBLE, &column);
+        MPI_Type_create_hvector(block.count[0], 1, block.plane * sizeof(double), column, &block.face[2]);
+        MPI_Type_free(&column);
+
+        MPI_Type_vector(block.count[1], block.count[2], block.width, MPI_DOUBLE, &block.face[0]);
+        MPI_Type_vector(block.count[0], block.count[2], block.plane, MPI_DOUBLE, &block.face[1]);
+        for (int d = 0; d < 3; d++) {
+            MPI_Type_commit(&block.face[d]);
+        }
+
+        return block;
+    }
+
+    /// <summary>Frees the process grid and datatypes of a block.</summary>
+    inline static void FreeBlock(Block3D& block) {
+        for (int d = 0; d < 3; d++) {
+            MPI_Type_free(&block.face[d]);
+        }
+        MPI_Comm_free(&block.comm);
+    }
+
+    /// <summary>Calculates the local index of the heat in the middle of the upper face of the volume.</summary>
+    /// <returns>The local index of the heat, -1 if this process does not own it.</returns>
+    inline static int GetHeatIndex(const Block3D& block, size_t n) {
+        size_t heat[3] = { n / 2, 0, n / 2 };
+        size_t index = 0, stride[3] = { block.plane, block.width, 1 };
+        for (int d = 0; d < 3; d++) {
+            if (heat[d] < block.start[d] || heat[d] >= block.start[d] + block.count[d]) {
+                return -1;
+            }
+            index += (heat[d] - block.start[d] + 1) * stride[d];
+        }
+
+        return (int)index;
+    }
+
+    /// <summary>Calculates the local index of the first point of a face.</summary>
+    /// <param name="d">The dimension the face is perpendicular to.</param>
+    /// <param name="position">The local position of the face along that dimension.</param>
+    inline static size_t FaceIndex(const Block3D& block, int d, size_t position) {
+        size_t index[3] = { 1, 1, 1 };
+        index[d] = position;
+        return index[0] * block.plane + index[1] * block.width + index[2];
+    }
+
+    /// <summary>Updates neighbouring processes by sending them the outer faces of this process' volume.
+    /// Then this process updates its halo with the data received from its neighbours.
+    /// The 7-point stencil needs no edges or corners of the halo, so only the faces are exchanged.</summary>
+    inline static void UpdateNeighbours(const Block3D& block, double* out) {
+        for (int d = 0; d < 3; d++) {
+            size_t count = block.count[d];
+
+            // send the lower face down and receive the upper halo, then the other way around
+            MPI_Sendrecv(&out[FaceIndex(block, d, 1)], 1, block.face[d], block.lower[d], 2 * d,
+                         &out[FaceIndex(block, d, count + 1)], 1, block.face[d], block.upper[d], 2 * d,
+                         block.comm, MPI_STATUS_IGNORE);
+            MPI_Sendrecv(&out[FaceIndex(block, d, count)], 1, block.face[d], block.upper[d], 2 * d + 1,
+                         &out[FaceIndex(block, d, 0)], 1, block.face[d], block.lower[d], 2 * d + 1,
+                         block.comm, MPI_STATUS_IGNORE);
+        }
+    }
+
+    /// <summary>Relaxes the volume until it is stable, exchanging the faces every iteration.</summary>
+    /// <param name="block">The block of this process.</param>
+    /// <param name="n">The width of the volume.</param>
+    /// <param name="heat">The heat value to place.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <returns>The number of iterations.</returns>
+    inline static int Solve(const Block3D& block, size_t n, double heat, double eps) {
+        double* in = Shared::CreateMatrix(block.size, GetHeatIndex(block, n), heat);
+        double* out = Shared::CreateMatrix(block.size, GetHeatIndex(block, n), heat);
+        double* tmp;
+
+        // both volumes need the outer points of the whole volume that lie in their halo, such as the heat
+        UpdateNeighbours(block, in);
+        UpdateNeighbours(block, out);
+
+        Tiling::Tile tile = Volume::GetTile(block.last[2] - block.first[2], block.last[1] - block.first[1]);
+
+        int iterations = 0;
+        bool stable = false;
+        while (!stable) {
+            double local_norm = Volume::Relax(in, out, block.width, block.plane, block.first, block.last, tile);
+            UpdateNeighbours(block, out);
+
+            double global_norm;
+            MPI_Allreduce(&local_norm, &global_norm, 1, MPI_DOUBLE, NORM == NORM_L2 ? MPI_SUM : MPI_MAX, block.comm);
+            stable = Shared::IsStable(global_norm, eps);
+            iterations++;
+
+            tmp = in;
+            in = out;
+            out = tmp;
+        }
+
+        Shared::FreeMatrix(in);
+        Shared::FreeMatrix(out);
+        return iterations;
+    }
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Shared.h"
+#include "Simd.h"
+#include "Tiling.h"
+#include "Checkpoint.h"
+
+/// <summary>Relaxation of a matrix with single Jacobi steps, alternating between two matrices.
+/// Every step stores the points as T and computes them in C, both double unless given, see Precision.h.</summary>
+class Jacobi {
+public:
+    /// <summary>Individual step of the 5-point stencil.</summary>
+    /// <typeparam name="T">The type the matrix is stored in.</typeparam>
+    /// <typeparam name="C">The type the points are computed in.</typeparam>
+    /// <param name="in">The original matrix.</param>
+    /// <param name="out">The resulting matrix.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="tiled">Whether to sweep the matrix in tiles instead of row by row.</param>
+    /// <param name="tile">The shape of a tile, only used when tiled.</param>
+    /// <param name="region">The inner points to sweep, see Active::Get.</param>
+    /// <param name="check">Whether to compute the norm of the change, which iterations that are not checked skip.</param>
+    /// <returns>The partial norm of the change of the region, see Shared::Accumulate, 0 when not checked.</returns>
+    template <typename T, typename C = T>
+    inline static double Relax(T* in, T* out, size_t n, bool tiled, Tiling::Tile tile, Region region, bool check) {
+        if (tiled) {
+            return Tiling::Relax<T, C>(in, out, n, n, tile, region, check);
+        }
+
+        if (!check) {
+            #pragma omp parallel for schedule(static)
+            for (size_t y = region.y0; y < region.y1; y++) {
+                Simd::SweepRow<T, C>(in, out, n, y, region.x0, region.x1);
+            }
+
+            return 0.0;
+        }
+
+        double norm = 0.0;
+        #pragma omp parallel for schedule(static) reduction(NORM_REDUCTION : norm)
+        for (size_t y = region.y0; y < region.y1; y++) {
+            norm = Shared::Combine(norm, Simd::DiffuseRow<T, C>(in, out, n, y, region.x0, region.x1));
+        }
+
+        return norm;
+    }
+
+    /// <summary>Advances a number of iterations, writing them alternately into two matrices.
+    /// Every iteration sweeps the region that the latest iteration in either matrix can have changed,
+    /// so the values of a later iteration are overwritten when rolling back.</summary>
+    /// <param name="from">The matrix to start from, which is left untouched.</param>
+    /// <param name="a">The matrix to write odd iterations into.</param>
+    /// <param name="b">The matrix to write even iterations into.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="heatIndex">The index of the hot point the matrices started from.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <param name="tiled">Whether to sweep the matrix in tiles.</param>
+    /// <param name="tile">The shape of a tile.</param>
+    /// <param name="iteration">The iteration from holds.</param>
+    /// <param name="reached">The latest iteration a or b can hold, 0 if it is before the ones to advance.</param>
+    /// <param name="steps">The number of iterations.</param>
+    /// <param name="checkAll">Whether to check every iteration instead of only the last one.</param>
+    /// <param name="last">Set to the matrix holding the last computed iteration.</param>
+    /// <returns>The first checked iteration that is stable, 0 if there is none.</returns>
+    template <typename T, typename C = T>
+    inline static int Advance(T* from, T* a, T* b, size_t n, size_t heatIndex, double eps, bool tiled, Tiling::Tile tile,
+                              int iteration, int reached, int steps, bool checkAll, T*& last) {
+        T* in = from;
+        for (int s = 1; s <= steps; s++) {
+            last = s % 2 == 1 ? a : b;
+            Region region = Active::Get(n, n, heatIndex, iteration + s > reached ? iteration + s : reached);
+            bool check = checkAll || s == steps;
+            double norm = Relax<T, C>(in, last, n, tiled, tile, region, check);
+            if (check && Shared::IsStable(norm, eps)) {
+                return s;
+            }
+
+            in = last;
+        }
+
+        return 0;
+    }
+
+    /// <summary>Iterates single steps until the matrix is stable.</summary>
+    /// <param name="saved">A matrix holding the starting point.</param>
+    /// <param name="in">A second matrix with the same boundary values.</param>
+    /// <param name="out">A third matrix with the same boundary values.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="heatIndex">The index of the hot point the matrices start from.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <param name="tiled">Whether to sweep the matrix in tiles instead of row by row.</param>
+    /// <param name="checkpoint">The checkpoints of the run, saved holds the iteration of the last one.</param>
+    /// <returns>The number of iterations.</returns>
+    template <typename T, typename C = T>
+    inline static int Iterate(T* saved, T* in, T* out, size_t n, size_t heatIndex, double eps, bool tiled, Checkpoint& checkpoint) {
+        T* last;
+        return Iterate<T, C>(saved, in, out, n, heatIndex, eps, tiled, checkpoint, last);
+    }
+
+    /// <summary>Iterates single steps until the matrix is stable, see Iterate.</summary>
+    /// <param name="last">Set to the matrix holding the first stable iteration.</param>
+    template <typename T, typename C = T>
+    inline static int Iterate(T* saved, T* in, T* out, size_t n, size_t heatIndex, double eps, bool tiled, Checkpoint& checkpoint, T*& last) {
+        int iterations = Checkpoints::Restart(checkpoint, saved, n, n, 0, 0);
+        last = saved;
+
+        // saved always holds the last checked iteration
+        Tiling::Tile tile = Tiling::GetTile<T>(n, n);
+        while (!Advance<T, C>(saved, in, out, n, heatIndex, eps, tiled, tile, iterations, 0, CHECK_EVERY, false, last)) {
+            if (last == in) {
+                in = saved;
+            } else {
+                out = saved;
+            }
+
+            saved = last;
+            iterations += CHECK_EVERY;
+            if (Checkpoints::Due(checkpoint, iterations)) {
+                Checkpoints::Write(checkpoint, saved, iterations);
+            }
+        }
+
+        // roll back and find the first stable iteration since the last check,
+        // in and out already hold iterations up to the one after CHECK_EVERY steps
+        if (CHECK_EVERY > 1) {
+            iterations += Advance<T, C>(saved, in, out, n, heatIndex, eps, tiled, tile, iterations, iterations + CHECK_EVERY, CHECK_EVERY, true, last);
+        } else {
+            iterations++;
+        }
+
+        return iterations;
+    }
+};
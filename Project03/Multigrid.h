@@ -0,0 +1,281 @@
+#pragma once
+
+#include "Shared.h"
+#include "Simd.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#define CYCLE_V 1
+#define CYCLE_W 2
+
+// number of times a level recurses into the next coarser level per cycle
+#define CYCLE CYCLE_V
+// smoothing sweeps before and after the coarse grid correction
+#define PRE_SMOOTH 2
+#define POST_SMOOTH 2
+// levels are coarsened until at most this many inner points remain per side
+#define COARSEST 3
+// sweeps on the coarsest level, enough to solve it
+#define COARSEST_SWEEPS 50
+// damping of the Jacobi smoother on the coarse levels, the fine level is smoothed by Shared::Diffuse
+#define OMEGA 0.75
+
+static_assert(STENCIL.Reach() <= 1, "the fine operator of multigrid is at most 3x3");
+
+class Multigrid {
+public:
+    /// <summary>A 5-point operator with constant coefficients, w[1 + dy][1 + dx] weighs the point at offset (dy, dx).</summary>
+    struct Operator {
+        double w[3][3];
+    };
+
+    /// <summary>A coarse level of the error equation A e = f, with a zero boundary.</summary>
+    struct Level {
+        size_t n;
+        Operator a;
+        double* e;
+        double* f;
+        double* t;
+    };
+
+    /// <summary>Solves the steady state with multigrid cycles until a step of Shared::Diffuse is stable.</summary>
+    /// <param name="x">The matrix to solve in place, also holding the boundary values.</param>
+    /// <param name="tmp">A second matrix with the same boundary values.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <param name="sweeps">Set to the number of sweeps over the fine matrix.</param>
+    /// <returns>The number of cycles.</returns>
+    inline static int Solve(double* x, double* tmp, size_t n, double eps, int& sweeps) {
+        std::vector<Level> levels = CreateLevels(n);
+        double* result = x;
+
+        sweeps = 0;
+        int cycles = 0;
+        while (true) {
+            for (int s = 0; s < PRE_SMOOTH; s++) {
+                Sweep(x, tmp, n);
+                std::swap(x, tmp);
+                sweeps++;
+            }
+
+            // the change made by a step is the residual of the steady state
+            double norm = Sweep(x, tmp, n);
+            sweeps++;
+            if (Shared::IsStable(norm, eps)) {
+                break;
+            }
+
+            cycles++;
+            if (!levels.empty()) {
+                Level& coarse = levels[0];
+                Change(x, tmp, n);
+                Restrict(tmp, n, coarse.f, coarse.n);
+                Clear(coarse.e, coarse.n);
+                for (int c = 0; c < CYCLE; c++) {
+                    Cycle(levels, 0);
+                }
+
+                Prolongate(coarse.e, coarse.n, x, n);
+            }
+
+            for (int s = 0; s < POST_SMOOTH; s++) {
+                Sweep(x, tmp, n);
+                std::swap(x, tmp);
+                sweeps++;
+            }
+        }
+
+        if (x != result) {
+            std::copy(x, x + n * n, result);
+        }
+
+        FreeLevels(levels);
+        return cycles;
+    }
+
+    /// <summary>Creates the coarse levels of a matrix, each with the operator of the level above it rediscretised.
+    /// Coarse point y lies on point 2y of the level above. An odd number of inner points puts the coarse boundary on
+    /// the fine one, an even number puts the last coarse point on the last fine inner point, next to the boundary.</summary>
+    /// <param name="n">The width of the fine matrix.</param>
+    /// <returns>The coarse levels from fine to coarse, empty if the matrix is already small enough.</returns>
+    inline static std::vector<Level> CreateLevels(size_t n) {
+        std::vector<Level> levels;
+        Operator a = FineOperator();
+        size_t inner = n - 2;
+        while (inner > COARSEST) {
+            inner = inner / 2;
+            a = Coarsen(a);
+
+            Level level;
+            level.n = inner + 2;
+            level.a = a;
+            level.e = Shared::CreateMatrix(level.n * level.n);
+            level.f = Shared::CreateMatrix(level.n * level.n);
+            level.t = Shared::CreateMatrix(level.n * level.n);
+            levels.push_back(level);
+        }
+
+        return levels;
+    }
+
+    inline static void FreeLevels(std::vector<Level>& levels) {
+        for (Level& level : levels) {
+            Shared::FreeMatrix(level.e);
+            Shared::FreeMatrix(level.f);
+            Shared::FreeMatrix(level.t);
+        }
+
+        levels.clear();
+    }
+
+    /// <summary>Derives the operator I - Diffuse of the fine level from Shared::Diffuse itself.</summary>
+    inline static Operator FineOperator() {
+        Operator a;
+        for (int y = 0; y < 3; y++) {
+            for (int x = 0; x < 3; x++) {
+                double in[9] = { 0.0 }, out[9] = { 0.0 };
+                in[y * 3 + x] = 1.0;
+                Shared::Diffuse(in, out, 3, 4);
+                a.w[y][x] = in[4] - out[4];
+            }
+        }
+
+        return a;
+    }
+
+    /// <summary>Rediscretises an operator on the next coarser level, which has twice the spacing.
+    /// Every pair of opposite weights is split into a symmetric diffusion part, which shrinks by four,
+    /// and a one-sided convection part, which shrinks by two. Unlike the Galerkin operator this keeps
+    /// every level diagonally dominant, so the Jacobi smoother stays stable on the coarsest levels as well.
+    /// Diagonal weights of a 9-point STENCIL are dropped, so the coarse levels only approximate it.</summary>
+    inline static Operator Coarsen(const Operator& a) {
+        Operator c = { { { 0.0 } } };
+        CoarsenPair(a.w[0][1], a.w[2][1], c.w[0][1], c.w[2][1]);
+        CoarsenPair(a.w[1][0], a.w[1][2], c.w[1][0], c.w[1][2]);
+        c.w[1][1] = -(c.w[0][1] + c.w[2][1] + c.w[1][0] + c.w[1][2]);
+        return c;
+    }
+
+private:
+    /// <summary>A single step of Shared::Diffuse over the fine matrix.</summary>
+    /// <returns>The partial norm of the change of the matrix, see Shared::Accumulate.</returns>
+    inline static double Sweep(double* in, double* out, size_t n) {
+        double norm = 0.0;
+        #pragma omp parallel for schedule(static) reduction(NORM_REDUCTION : norm)
+        for (size_t y = 1; y < n - 1; y++) {
+            norm = Shared::Combine(norm, Simd::DiffuseRow(in, out, n, y, 1, n - 1));
+        }
+
+        return norm;
+    }
+
+    /// <summary>Replaces the inner points of a step by the change it made, which is the residual of the fine level.</summary>
+    /// <param name="in">The original matrix.</param>
+    /// <param name="out">The result of a step of Shared::Diffuse, replaced by out - in.</param>
+    /// <param name="n">The width of the matrix.</param>
+    inline static void Change(double* in, double* out, size_t n) {
+        #pragma omp parallel for schedule(static)
+        for (size_t y = 1; y < n - 1; y++) {
+            for (size_t i = y * n + 1; i < y * n + n - 1; i++) {
+                out[i] = out[i] - in[i];
+            }
+        }
+    }
+
+    inline static void CoarsenPair(double a0, double a1, double& c0, double& c1) {
+        double diffusion = fmin(-a0, -a1);
+        c0 = -(diffusion / 4.0 + (-a0 - diffusion) / 2.0);
+        c1 = -(diffusion / 4.0 + (-a1 - diffusion) / 2.0);
+    }
+
+    inline static double Apply(const Operator& a, double* e, size_t n, size_t i) {
+        return a.w[1][1] * e[i]
+             + a.w[0][1] * e[i - n]
+             + a.w[2][1] * e[i + n]
+             + a.w[1][0] * e[i - 1]
+             + a.w[1][2] * e[i + 1];
+    }
+
+    /// <summary>Damped Jacobi sweeps on the error equation of a coarse level.</summary>
+    inline static void Smooth(Level& level, int sweeps) {
+        size_t n = level.n;
+        for (int s = 0; s < sweeps; s++) {
+            #pragma omp parallel for schedule(static)
+            for (size_t y = 1; y < n - 1; y++) {
+                for (size_t i = y * n + 1; i < y * n + n - 1; i++) {
+                    level.t[i] = level.e[i] + OMEGA * (level.f[i] - Apply(level.a, level.e, n, i)) / level.a.w[1][1];
+                }
+            }
+
+            std::swap(level.e, level.t);
+        }
+    }
+
+    /// <summary>Writes the residual f - A e of a coarse level into its scratch matrix.</summary>
+    inline static void Residual(Level& level) {
+        size_t n = level.n;
+        #pragma omp parallel for schedule(static)
+        for (size_t y = 1; y < n - 1; y++) {
+            for (size_t i = y * n + 1; i < y * n + n - 1; i++) {
+                level.t[i] = level.f[i] - Apply(level.a, level.e, n, i);
+            }
+        }
+    }
+
+    /// <summary>Full weighting of the inner points of a fine matrix onto a coarse one.
+    /// The last coarse row and column of a fine matrix with an even number of inner points lie next to the fine
+    /// boundary, which holds boundary values instead of a residual, so it is left out of their weighting.</summary>
+    inline static void Restrict(double* fine, size_t n, double* coarse, size_t nc) {
+        #pragma omp parallel for schedule(static)
+        for (size_t y = 1; y < nc - 1; y++) {
+            double below = 2 * y + 1 < n - 1 ? 1.0 : 0.0;
+            for (size_t x = 1; x < nc - 1; x++) {
+                double right = 2 * x + 1 < n - 1 ? 1.0 : 0.0;
+                size_t i = 2 * y * n + 2 * x;
+                coarse[y * nc + x] = 0.25 * fine[i]
+                    + 0.125 * (fine[i - n] + below * fine[i + n] + fine[i - 1] + right * fine[i + 1])
+                    + 0.0625 * (fine[i - n - 1] + right * fine[i - n + 1] + below * fine[i + n - 1] + below * right * fine[i + n + 1]);
+            }
+        }
+    }
+
+    /// <summary>Adds the bilinear interpolation of a coarse matrix to the inner points of a fine one.
+    /// Every fine inner point lies between inner coarse points or the coarse boundary, see CreateLevels.</summary>
+    inline static void Prolongate(double* coarse, size_t nc, double* fine, size_t n) {
+        #pragma omp parallel for schedule(static)
+        for (size_t y = 1; y < n - 1; y++) {
+            size_t cy0 = y / 2, cy1 = (y + 1) / 2;
+            for (size_t x = 1; x < n - 1; x++) {
+                size_t cx0 = x / 2, cx1 = (x + 1) / 2;
+                fine[y * n + x] += 0.25 * (coarse[cy0 * nc + cx0] + coarse[cy0 * nc + cx1]
+                                         + coarse[cy1 * nc + cx0] + coarse[cy1 * nc + cx1]);
+            }
+        }
+    }
+
+    inline static void Clear(double* m, size_t n) {
+        std::fill(m, m + n * n, 0.0);
+    }
+
+    /// <summary>A single cycle on a coarse level, recursing CYCLE times into the next coarser level.</summary>
+    inline static void Cycle(std::vector<Level>& levels, size_t k) {
+        Level& level = levels[k];
+        if (k + 1 == levels.size()) {
+            Smooth(level, COARSEST_SWEEPS);
+            return;
+        }
+
+        Level& coarse = levels[k + 1];
+        Smooth(level, PRE_SMOOTH);
+        Residual(level);
+        Restrict(level.t, level.n, coarse.f, coarse.n);
+        Clear(coarse.e, coarse.n);
+        for (int c = 0; c < CYCLE; c++) {
+            Cycle(levels, k + 1);
+        }
+
+        Prolongate(coarse.e, coarse.n, level.e, level.n);
+        Smooth(level, POST_SMOOTH);
+    }
+};
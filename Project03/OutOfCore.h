@@ -0,0 +1,236 @@
+#pragma once
+
+#include "Shared.h"
+#include <string.h>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// directory of the files that hold the matrices, it should be on the disk that is measured
+#define DISK_PATH "."
+// number of iterations a row advances during a single pass over the files
+#define DISK_STEPS 8
+// number of rows that are prefetched ahead and written back at once
+#define DISK_BAND 64
+
+/// <summary>A flattened matrix that is kept in a memory-mapped file.</summary>
+struct DiskMatrix {
+    std::string path;
+    int fd;
+    double* data;
+    size_t size;    // size of the file in bytes
+};
+
+/// <summary>Relaxation of matrices that do not fit in memory. A pass streams the rows of one file into the other
+/// and advances every row DISK_STEPS iterations on the way, as a wavefront: when row y of the file is read,
+/// iteration t computes row y - 2t. Only four rows of every iteration in between are kept in memory,
+/// so a pass reads and writes each file once for DISK_STEPS iterations.</summary>
+class OutOfCore {
+public:
+    static_assert(STENCIL.Reach() <= 1, "The wavefront keeps the rows directly above and below a row only.");
+
+    /// <summary>Creates a file of zeroes for a matrix and maps it into memory.</summary>
+    /// <param name="name">The name of the file in DISK_PATH.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="heatIndex">At what index to place the heat, -1 if no heat should be added.</param>
+    /// <param name="heat">The heat value to place.</param>
+    /// <returns>The mapped matrix.</returns>
+    inline static DiskMatrix CreateMatrix(const std::string name, size_t n, int heatIndex = -1, double heat = HEAT) {
+        DiskMatrix m;
+        m.path = std::string(DISK_PATH) + "/" + name + ".bin";
+        m.size = n * n * sizeof(double);
+        m.fd = open(m.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (m.fd < 0 || ftruncate(m.fd, m.size) != 0) {
+            printf("Could not create file '%s'.\n", m.path.c_str());
+            exit(1);
+        }
+
+        void* data = mmap(NULL, m.size, PROT_READ | PROT_WRITE, MAP_SHARED, m.fd, 0);
+        if (data == MAP_FAILED) {
+            printf("Could not map file '%s'.\n", m.path.c_str());
+            exit(1);
+        }
+
+        m.data = (double*)data;
+        madvise(m.data, m.size, MADV_SEQUENTIAL);
+        if (heatIndex >= 0) {
+            m.data[heatIndex] = heat;
+        }
+        return m;
+    }
+
+    /// <summary>Unmaps a matrix and removes its file.</summary>
+    inline static void FreeMatrix(DiskMatrix& m) {
+        munmap(m.data, m.size);
+        close(m.fd);
+        unlink(m.path.c_str());
+    }
+
+    /// <summary>Reads the number of bytes this process caused to be read from and written to disk.</summary>
+    /// <returns>The number of bytes, 0 if the kernel does not account for them.</returns>
+    inline static size_t DiskTraffic() {
+        size_t total = 0;
+        FILE* file = fopen("/proc/self/io", "r");
+        if (file != NULL) {
+            char name[64];
+            unsigned long long value;
+            while (fscanf(file, "%63[^:]: %llu\n", name, &value) == 2) {
+                if (strcmp(name, "read_bytes") == 0 || strcmp(name, "write_bytes") == 0) {
+                    total += value;
+                }
+            }
+            fclose(file);
+        }
+
+        return total;
+    }
+
+    /// <summary>Relaxes the matrix until it is stable. Every iteration of a pass is checked, and when the first stable
+    /// iteration lies in the middle of a pass, the pass is repeated from its start up to that iteration.</summary>
+    /// <param name="a">A matrix holding the starting point.</param>
+    /// <param name="b">A second matrix of the same size.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <param name="last">Set to the matrix holding the stable iteration.</param>
+    /// <param name="streamed">Set to the number of bytes that were read from and written to the files.</param>
+    /// <returns>The number of iterations.</returns>
+    inline static int Solve(DiskMatrix& a, DiskMatrix& b, size_t n, double eps, DiskMatrix*& last, size_t& streamed) {
+        DiskMatrix* in = &a;
+        DiskMatrix* out = &b;
+
+        int iterations = 0;
+        streamed = 0;
+        while (true) {
+            int stable = Pass(in->data, out->data, n, DISK_STEPS, eps);
+            streamed += 2 * in->size;
+
+            if (stable > 0 && stable < DISK_STEPS) {
+                Pass(in->data, out->data, n, stable, eps);
+                streamed += 2 * in->size;
+            }
+            if (stable > 0) {
+                msync(out->data, out->size, MS_SYNC);
+                last = out;
+                return iterations + stable;
+            }
+
+            iterations += DISK_STEPS;
+            DiskMatrix* tmp = in;
+            in = out;
+            out = tmp;
+        }
+    }
+
+    /// <summary>Advances every row of the matrix a number of iterations in a single pass over both files.</summary>
+    /// <param name="src">The original matrix, which is left untouched.</param>
+    /// <param name="dst">The matrix to write the last iteration into.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="steps">The number of iterations.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <returns>The first iteration that is stable, 0 if there is none.</returns>
+    inline static int Pass(const double* src, double* dst, size_t n, int steps, double eps) {
+        // the rows y - 1 to y + 2 of every iteration in between, stored at y % 4
+        double* rings = steps > 1 ? Shared::CreateMatrix(4 * n * (steps - 1)) : NULL;
+        auto row = [&](int t, size_t y) -> double* {
+            if (t == 0) {
+                return (double*)src + y * n;
+            }
+            if (t == steps) {
+                return dst + y * n;
+            }
+            return rings + (4 * (t - 1) + y % 4) * n;
+        };
+
+        // the norm of the change of every iteration, the first one at index 1
+        std::vector<double> norms(steps + 1, 0.0);
+        for (size_t y = 0; y < n + 2 * steps; y++) {
+            if (y % DISK_BAND == 0) {
+                Advise(src, n, y, y + DISK_BAND, MADV_WILLNEED);
+                if (y >= 2 * (size_t)steps + DISK_BAND) {
+                    Sync(dst, n, y - 2 * steps - DISK_BAND, y - 2 * steps);
+                }
+            }
+
+            // row y - 2t of iteration t only depends on rows of iteration t - 1 computed before y,
+            // so the iterations are independent of each other
+            #pragma omp parallel for schedule(static)
+            for (int t = 1; t <= steps; t++) {
+                if (y < 2 * (size_t)t || y - 2 * t >= n) {
+                    continue;
+                }
+
+                size_t r = y - 2 * t;
+                if (r == 0 || r == n - 1) {
+                    memcpy(row(t, r), row(0, r), n * sizeof(double));
+                    continue;
+                }
+
+                const double* rows[3] = { row(t - 1, r - 1), row(t - 1, r), row(t - 1, r + 1) };
+                norms[t] = Shared::Combine(norms[t], RelaxRow(rows, row(t, r), n));
+            }
+        }
+
+        Shared::FreeMatrix(rings);
+
+        for (int t = 1; t <= steps; t++) {
+            if (Shared::IsStable(norms[t], eps)) {
+                return t;
+            }
+        }
+        return 0;
+    }
+
+private:
+    /// <summary>Relaxes the inner points of a row, whose neighbouring rows are stored elsewhere.</summary>
+    /// <param name="rows">The rows above, at and below the row of the original matrix.</param>
+    /// <param name="out">The resulting row.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <returns>The partial norm of the change of the row, see Shared::Accumulate.</returns>
+    inline static double RelaxRow(const double* const* rows, double* out, size_t n) {
+        double norm = 0.0;
+        #pragma omp simd reduction(NORM_REDUCTION : norm)
+        for (size_t x = 1; x < n - 1; x++) {
+            out[x] = Kernel<STENCIL>::ApplyRows(rows + 1, x);
+            norm = Shared::Accumulate(norm, rows[1][x] - out[x]);
+        }
+
+        out[0] = rows[1][0];
+        out[n - 1] = rows[1][n - 1];
+        return norm;
+    }
+
+    /// <summary>Gives advice about the pages of the rows [first, last) of a mapped matrix.</summary>
+    inline static void Advise(const double* m, size_t n, size_t first, size_t last, int advice) {
+        char* begin;
+        size_t length;
+        if (Pages(m, n, first, last, begin, length)) {
+            madvise(begin, length, advice);
+        }
+    }
+
+    /// <summary>Starts writing the rows [first, last) of a mapped matrix back to its file.</summary>
+    inline static void Sync(const double* m, size_t n, size_t first, size_t last) {
+        char* begin;
+        size_t length;
+        if (Pages(m, n, first, last, begin, length)) {
+            msync(begin, length, MS_ASYNC);
+        }
+    }
+
+    /// <summary>Calculates the whole pages that hold the rows [first, last) of a mapped matrix.</summary>
+    /// <returns>Whether there are any such rows.</returns>
+    inline static bool Pages(const double* m, size_t n, size_t first, size_t last, char*& begin, size_t& length) {
+        last = last < n ? last : n;
+        if (first >= last) {
+            return false;
+        }
+
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t start = first * n * sizeof(double) / page * page;
+        begin = (char*)m + start;
+        length = last * n * sizeof(double) - start;
+        return true;
+    }
+};
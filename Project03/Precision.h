@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Shared.h"
+#include <stdint.h>
+#include <string.h>
+
+// type the points of the matrices of Relax.cpp and RelaxMPI.cpp are stored in: double, float or bfloat16,
+// the stencil is memory bound, so a narrower type moves fewer bytes per point
+#define STORAGE double
+// type the points are computed in, at least as wide as STORAGE
+#define COMPUTE double
+
+/// <summary>A 16-bit float with the exponent of a float and 8 bits of precision, used for storage only.</summary>
+struct bfloat16 {
+    uint16_t bits;
+
+    bfloat16() = default;
+
+    /// <summary>Rounds a float to the nearest bfloat16, ties to even.</summary>
+    explicit bfloat16(float value) {
+        uint32_t b;
+        memcpy(&b, &value, sizeof(b));
+        bits = (uint16_t)((b + 0x7FFF + ((b >> 16) & 1)) >> 16);
+    }
+
+    explicit bfloat16(double value) : bfloat16((float)value) { }
+
+    operator float() const {
+        uint32_t b = (uint32_t)bits << 16;
+        float value;
+        memcpy(&value, &b, sizeof(value));
+        return value;
+    }
+};
+
+/// <summary>The name of a type as written to the csv files.</summary>
+template <typename T> struct TypeName;
+template <> struct TypeName<double> { static constexpr const char* value = "double"; };
+template <> struct TypeName<float> { static constexpr const char* value = "float"; };
+template <> struct TypeName<bfloat16> { static constexpr const char* value = "bfloat16"; };
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Shared.h"
+
+// relax in place in red-black order instead of from one matrix into another
+#define RED_BLACK false
+// over-relaxation factor of the red-black sweeps, 1 is Gauss-Seidel and above 1 is SOR,
+// values close to 2 can diverge because the weights of Shared::Diffuse are not symmetric
+#define SOR_OMEGA 1.0
+
+#define RED 0
+#define BLACK 1
+
+static_assert(!RED_BLACK || !STENCIL.Diagonal(), "diagonal points couple points of the same colour");
+
+/// <summary>Gauss-Seidel with red-black ordering on a single matrix. A point is red when the sum of its
+/// global coordinates is even. Points of one colour only depend on points of the other colour,
+/// so every half-sweep can be relaxed in any order, by any number of threads or processes.</summary>
+class RedBlack {
+public:
+    /// <summary>Turns the change of Shared::Diffuse into the Gauss-Seidel update, which solves a point exactly.
+    /// This is one over the total weight of the neighbours, derived from Shared::Diffuse itself.</summary>
+    inline static double Scale() {
+        static const double scale = [] {
+            double in[9] = { 0.0 }, out[9] = { 0.0 };
+            in[4] = 1.0;
+            Shared::Diffuse(in, out, 3, 4);
+            return 1.0 / (1.0 - out[4]);
+        }();
+        return scale;
+    }
+
+    /// <summary>Relaxes the points of one colour in a rectangle of a matrix in place.</summary>
+    /// <typeparam name="T">The type the matrix is stored in.</typeparam>
+    /// <typeparam name="C">The type the points are computed in.</typeparam>
+    /// <param name="m">The matrix.</param>
+    /// <param name="width">The width of the matrix.</param>
+    /// <param name="y0">The first row to relax.</param>
+    /// <param name="y1">The row after the last one to relax.</param>
+    /// <param name="x0">The first column to relax.</param>
+    /// <param name="x1">The column after the last one to relax.</param>
+    /// <param name="color">The colour to relax, as if the local coordinates were global ones.</param>
+    /// <returns>The partial norm of the change of the relaxed points, see Shared::Accumulate.</returns>
+    template <typename T = double, typename C = T>
+    inline static double Relax(T* m, size_t width, size_t y0, size_t y1, size_t x0, size_t x1, int color) {
+        const C factor = C(SOR_OMEGA * Scale());
+
+        double norm = 0.0;
+        #pragma omp parallel for schedule(static) reduction(NORM_REDUCTION : norm)
+        for (size_t y = y0; y < y1; y++) {
+            size_t x = x0 + (x0 + y + color) % 2;
+            for (size_t i = y * width + x; i < y * width + x1; i += 2) {
+                C old = C(m[i]);
+                Shared::Diffuse<T, C>(m, m, width, i);
+                m[i] = T(old + factor * (C(m[i]) - old));
+                norm = Shared::Accumulate(norm, (double)(C(m[i]) - old));
+            }
+        }
+
+        return norm;
+    }
+
+    /// <summary>Relaxes a matrix in place until it is stable.</summary>
+    /// <param name="m">The matrix.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <returns>The number of iterations, each a red and a black half-sweep.</returns>
+    inline static int Solve(double* m, size_t n, double eps) {
+        int iterations = 0;
+        double norm;
+        do {
+            norm = Relax(m, n, 1, n - 1, 1, n - 1, RED);
+            norm = Shared::Combine(norm, Relax(m, n, 1, n - 1, 1, n - 1, BLACK));
+            iterations++;
+        } while (!Shared::IsStable(norm, eps));
+
+        return iterations;
+    }
+};
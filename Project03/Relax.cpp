@@ -1,66 +1,95 @@
 #include "Shared.h"
-#include <time.h>
+#include "Jacobi.h"
+#include "Precision.h"
+#include "Multigrid.h"
+#include "RedBlack.h"
+#include "Affinity.h"
+
+// sweep the matrix in cache-sized tiles instead of row by row
+#define TILED false
+// solve with multigrid cycles instead of single steps, results are written to multigrid.csv
+#define MULTIGRID false
 
 /// <summary>Prints information about the state of the program.</summary>
-static void PrintMatrix(int n, double heat, double eps, int iterations, clock_t start, clock_t end) {
+/// <param name="point">The size of a point of the matrix in bytes.</param>
+static void PrintMatrix(int n, double heat, double eps, int iterations, int cycles, int ms, size_t point) {
     printf("N         : %d\n", n);
-    printf("Size      : %dMB\n", (int)(n * n * sizeof(double) / (1024 * 1024)));
+    printf("Size      : %dMB\n", (int)(n * n * point / (1024 * 1024)));
     printf("Heat      : %f\n", heat);
     printf("Epsilon   : %f\n", eps);
     printf("Iterations: %d\n", iterations);
-    printf("Time      : %dms\n", (int)((end - start) / (CLOCKS_PER_SEC / 1000.0)));
+    if (cycles >= 0) {
+        printf("Cycles    : %d\n", cycles);
+    }
+    printf("Time      : %dms\n", ms);
     printf("\n");
 }
 
-/// <summary>Individual step of the 5-point stencil.</summary>
-/// <param name="in">The original matrix.</param>
-/// <param name="out">The resulting matrix.</param>
-/// <param name="n">The width of the matrix.</param>
-/// <param name="eps">The epsilon value.</param>
-/// <returns>Whether the resulting matrix is stable.</returns>
-static bool Relax(double* in, double* out, size_t n, double eps) {
-    bool stable = true;
-    for (size_t y = 1; y < n - 1; y++) {
-        for (size_t x = 1; x < n - 1; x++) {
-            size_t index = x + y * n;
-            Shared::Diffuse(in, out, n, index);
-            if (stable && fabs(in[index] - out[index]) > eps) {
-                stable = false;
-            }
-        }
-    }
+/// <summary>Relaxes a matrix with single Jacobi steps, storing the points as T and computing them in C.</summary>
+/// <returns>The number of iterations.</returns>
+template <typename T, typename C>
+static int Iterate(size_t n, double heat, double eps) {
+    T* saved = Shared::CreateMatrix<T>(n * n, n / 2, heat);
+    T* in = Shared::CreateMatrix<T>(n * n, n / 2, heat);
+    T* out = Shared::CreateMatrix<T>(n * n, n / 2, heat);
+    Checkpoint checkpoint;
+    Checkpoints::Create(checkpoint, "relax", n, heat, eps);
+    int iterations = Jacobi::Iterate<T, C>(saved, in, out, n, n / 2, eps, TILED, checkpoint);
+    Checkpoints::Finish(checkpoint);
 
-    return stable;
+    Shared::FreeMatrix(saved);
+    Shared::FreeMatrix(in);
+    Shared::FreeMatrix(out);
+    return iterations;
 }
 
 static void Run(std::ofstream& file, size_t n, double heat, double eps) {
-    clock_t start = clock();
+    double start = Shared::Now();
+    std::vector<int> counters = Counters::Start();
+
+    int iterations, cycles = -1;
+    size_t point = sizeof(double);
+    CounterValues values;
+    double* in = NULL;
+    double* out = NULL;
 
-    int iterations = 1;
-    double* in = Shared::CreateMatrix(n * n, n / 2, heat);
-    double* out = Shared::CreateMatrix(n * n, n / 2, heat);
-    double* tmp;
+    if (MULTIGRID) {
+        // iterations are the sweeps over the fine matrix, which make up most of the work of a cycle
+        in = Shared::CreateMatrix(n * n, n / 2, heat);
+        out = Shared::CreateMatrix(n * n, n / 2, heat);
+        cycles = Multigrid::Solve(in, out, n, eps, iterations);
+    } else if (RED_BLACK) {
+        in = Shared::CreateMatrix(n * n, n / 2, heat);
+        iterations = RedBlack::Solve(in, n, eps);
+    } else {
+        iterations = Iterate<STORAGE, COMPUTE>(n, heat, eps);
+        point = sizeof(STORAGE);
 
-    while (!Relax(in, out, n, eps)) {
-        tmp = in;
-        in = out;
-        out = tmp;
-        iterations++;
+        // every swept point reads the input and writes the output, which is first read into the cache
+        double points = Active::Points(n, n, n / 2, iterations);
+        values.flops = points * STENCIL.Flops();
+        values.bytes = points * 3 * point;
     }
 
-    clock_t end = clock();
-    free(in);
-    free(out);
+    int ms = (int)(Shared::Now() - start);
+    Counters::Stop(counters, values);
+    Shared::FreeMatrix(in);
+    Shared::FreeMatrix(out);
 
-    Shared::WriteInfo(file, n, iterations, (int)((end - start) / (CLOCKS_PER_SEC / 1000.0)));
-    PrintMatrix(n, heat, eps, iterations, start, end);
+    Shared::WriteInfo(file, n, iterations, ms, -1, cycles, 2, COUNTERS ? &values : NULL, point);
+    PrintMatrix(n, heat, eps, iterations, cycles, ms, point);
 }
 
 int main() {
-    std::ofstream file = Shared::OpenFile("relax");
+    Affinity::Pin();
+    std::string columns = std::string(MULTIGRID ? "N,Size,Iterations,Time,Cycles" : "N,Size,Iterations,Time") + COUNTER_COLUMNS;
+    std::ofstream file = Shared::OpenFile(MULTIGRID ? "multigrid" : RED_BLACK ? "redblack" : "relax", COUNTERS ? columns : "");
 
     for (int i = 1; i <= STEPS; i++) {
         for (int r = 0; r < REPEATS; r++) {
+            if (COLD_RUNS) {
+                Arena::Reset();
+            }
             Run(file, i * N, HEAT, EPS);
         }
     }
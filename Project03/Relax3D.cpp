@@ -0,0 +1,60 @@
+#include "Shared.h"
+#include "Volume.h"
+#include "Affinity.h"
+
+// sweep the volume in cache-sized tiles of rows and columns instead of plane by plane
+#define TILED true
+
+/// <summary>Prints information about the state of the program.</summary>
+static void PrintVolume(int n, Tiling::Tile tile, double heat, double eps, int iterations, int ms) {
+    printf("N         : %d\n", n);
+    printf("Size      : %dMB\n", (int)((size_t)n * n * n * sizeof(double) / (1024 * 1024)));
+    printf("Tile      : %zux%zu\n", tile.height, tile.width);
+    printf("Heat      : %f\n", heat);
+    printf("Epsilon   : %f\n", eps);
+    printf("Iterations: %d\n", iterations);
+    printf("Time      : %dms\n", ms);
+    printf("\n");
+}
+
+static void Run(std::ofstream& file, size_t n, double heat, double eps) {
+    double start = Shared::Now();
+    std::vector<int> counters = Counters::Start();
+
+    double* in = Shared::CreateMatrix(n * n * n, (int)Volume::GetHeatIndex(n), heat);
+    double* out = Shared::CreateMatrix(n * n * n, (int)Volume::GetHeatIndex(n), heat);
+
+    Tiling::Tile tile = { n - 2, n - 2 };
+    if (TILED) {
+        tile = Volume::GetTile(n - 2, n - 2);
+    }
+    int iterations = Volume::Solve(in, out, n, eps, tile);
+
+    int ms = (int)(Shared::Now() - start);
+    CounterValues values;
+    Counters::Stop(counters, values);
+    values.flops = (double)iterations * (n - 2) * (n - 2) * (n - 2) * STENCIL_3D.Flops();
+    values.bytes = (double)iterations * n * n * n * 3 * sizeof(double);
+    Shared::FreeMatrix(in);
+    Shared::FreeMatrix(out);
+
+    Shared::WriteInfo(file, n, iterations, ms, -1, -1, 3, COUNTERS ? &values : NULL);
+    PrintVolume(n, tile, heat, eps, iterations, ms);
+}
+
+int main() {
+    Affinity::Pin();
+    std::ofstream file = Shared::OpenFile("relax3d", COUNTERS ? "N,Size,Iterations,Time" COUNTER_COLUMNS : "");
+
+    for (int i = 1; i <= STEPS; i++) {
+        for (int r = 0; r < REPEATS; r++) {
+            if (COLD_RUNS) {
+                Arena::Reset();
+            }
+            Run(file, i * N_3D, HEAT, EPS);
+        }
+    }
+
+    file.close();
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "Shared.h"
+#include "OutOfCore.h"
+#include "Affinity.h"
+
+/// <summary>Prints information about the state of the program.</summary>
+static void PrintMatrix(int n, double heat, double eps, int iterations, int ms, double streamed, double disk) {
+    printf("N         : %d\n", n);
+    printf("Size      : %dMB\n", (int)((size_t)n * n * sizeof(double) / (1024 * 1024)));
+    printf("Heat      : %f\n", heat);
+    printf("Epsilon   : %f\n", eps);
+    printf("Iterations: %d\n", iterations);
+    printf("Steps     : %d\n", DISK_STEPS);
+    printf("Streamed  : %.2fMB per iteration\n", streamed);
+    printf("Disk      : %.2fMB per iteration\n", disk);
+    printf("Time      : %dms\n", ms);
+    printf("\n");
+}
+
+static void Run(std::ofstream& file, size_t n, double heat, double eps) {
+    size_t traffic = OutOfCore::DiskTraffic();
+    // the time spent waiting for the disk counts, so this measures wall-clock time instead of processor time
+    double start = Shared::Now();
+
+    DiskMatrix a = OutOfCore::CreateMatrix("relax_a", n, n / 2, heat);
+    DiskMatrix b = OutOfCore::CreateMatrix("relax_b", n, n / 2, heat);
+    DiskMatrix* last;
+    size_t streamed;
+    int iterations = OutOfCore::Solve(a, b, n, eps, last, streamed);
+
+    int ms = (int)(Shared::Now() - start);
+    traffic = OutOfCore::DiskTraffic() - traffic;
+    OutOfCore::FreeMatrix(a);
+    OutOfCore::FreeMatrix(b);
+
+    double streamedMB = (double)streamed / iterations / (1024 * 1024);
+    double diskMB = (double)traffic / iterations / (1024 * 1024);
+    file << n << ","
+         << (int)(n * n * sizeof(double) / (1024 * 1024)) << ","
+         << iterations << ","
+         << ms << ","
+         << DISK_STEPS << ","
+         << streamedMB << ","
+         << diskMB << std::endl;
+    PrintMatrix(n, heat, eps, iterations, ms, streamedMB, diskMB);
+}
+
+/// <summary>Solves the same matrices as Relax.cpp, with both matrices kept in files in DISK_PATH.
+/// Streamed is the data a pass moves between the files and memory, Disk is the part of it that
+/// actually reached the disk instead of the page cache, both in MB per iteration.</summary>
+int main() {
+    Affinity::Pin();
+    std::ofstream file = Shared::OpenFile("disk", "N,Size,Iterations,Time,Steps,Streamed,Disk");
+
+    for (int i = 1; i <= STEPS; i++) {
+        for (int r = 0; r < REPEATS; r++) {
+            Run(file, i * N, HEAT, EPS);
+        }
+    }
+
+    file.close();
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "Shared.h"
+#include "Distributed3D.h"
+
+/// <summary>Prints information about the state of the program.</summary>
+static void PrintBlock(const Block3D& block, int n, double heat, double eps, int iterations, double start, double end) {
+    printf("Rank      : %d\n", block.rank);
+    printf("World     : %d\n", block.worldSize);
+    printf("Grid      : %dx%dx%d\n", block.dims[0], block.dims[1], block.dims[2]);
+    printf("N         : %d\n", n);
+    printf("Block     : %zux%zux%zu\n", block.count[0], block.count[1], block.count[2]);
+    printf("Size      : %dMB\n", (int)(block.size * sizeof(double) / (1024 * 1024)));
+    printf("Heat      : %f\n", heat);
+    printf("Epsilon   : %f\n", eps);
+    printf("Iterations: %d\n", iterations);
+    printf("Time      : %dms\n", (int)((end - start) * 1000.0));
+    printf("\n");
+}
+
+static void Run(std::ofstream& file, size_t n, double heat, double eps) {
+    double start = MPI_Wtime();
+    std::vector<int> counters = Counters::Start();
+
+    Block3D block = Distributed3D::CreateBlock(n);
+    int iterations = Distributed3D::Solve(block, n, heat, eps);
+
+    double end = MPI_Wtime();
+
+    // the counters and the work are those of this process, like the time
+    CounterValues values;
+    Counters::Stop(counters, values);
+    values.flops = (double)iterations * STENCIL_3D.Flops();
+    values.bytes = (double)iterations * 3 * sizeof(double);
+    for (int d = 0; d < 3; d++) {
+        values.flops *= block.last[d] - block.first[d];
+        values.bytes *= block.count[d];
+    }
+    Shared::WriteInfo(file, n, iterations, (int)((end - start) * 1000.0), block.worldSize, -1, 3, COUNTERS ? &values : NULL);
+    PrintBlock(block, n, heat, eps, iterations, start, end);
+    Distributed3D::FreeBlock(block);
+}
+
+int main(int argc, char** argv) {
+    Distributed::Init(&argc, &argv);
+
+    // every process appends its own rows, rank 0 writes the header before any of them
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    std::ofstream file = Shared::OpenFile("mpi3d", COUNTERS && rank == 0 ? "Cores,N,Size,Iterations,Time" COUNTER_COLUMNS : "");
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // the processes on a node pin their threads to different cores
+    Affinity::Pin(Distributed::LocalRank() * Affinity::Threads());
+
+    for (int i = 1; i <= STEPS; i++) {
+        for (int r = 0; r < REPEATS; r++) {
+            if (COLD_RUNS) {
+                Arena::Reset();
+            }
+            Run(file, i * N_3D, HEAT, EPS);
+            MPI_Barrier(MPI_COMM_WORLD);
+        }
+    }
+
+    MPI_Finalize();
+    file.close();
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "Shared.h"
+#include "Affinity.h"
+
+// number of doubles of every array of the bandwidth probe, at least four times the last level cache like STREAM
+#define STREAM_SIZE (1 << 25)
+// number of times every probe runs, the best time is kept like STREAM does
+#define PROBE_REPEATS 10
+// number of independent chains of multiply-adds per thread, enough vectors to keep every FMA unit busy
+#define PEAK_CHAINS 64
+// number of multiply-adds of every chain
+#define PEAK_STEPS (1 << 22)
+
+/// <summary>The best bandwidth of copying one array into another, c = a.</summary>
+/// <returns>The bandwidth in GB/s, counting the bytes that are read and written like STREAM.</returns>
+static double Copy(const double* a, double* c) {
+    double best = 0.0;
+    for (int r = 0; r < PROBE_REPEATS; r++) {
+        double start = Shared::Now();
+        #pragma omp parallel for simd schedule(static)
+        for (size_t i = 0; i < STREAM_SIZE; i++) {
+            c[i] = a[i];
+        }
+        double ms = Shared::Now() - start;
+        best = fmax(best, 2.0 * sizeof(double) * STREAM_SIZE / ms / 1e6);
+    }
+    return best;
+}
+
+/// <summary>The best bandwidth of the STREAM triad a = b + s * c.</summary>
+/// <returns>The bandwidth in GB/s, counting the bytes that are read and written like STREAM.</returns>
+static double Triad(double* a, const double* b, const double* c) {
+    double best = 0.0;
+    for (int r = 0; r < PROBE_REPEATS; r++) {
+        double start = Shared::Now();
+        #pragma omp parallel for simd schedule(static)
+        for (size_t i = 0; i < STREAM_SIZE; i++) {
+            a[i] = b[i] + 3.0 * c[i];
+        }
+        double ms = Shared::Now() - start;
+        best = fmax(best, 3.0 * sizeof(double) * STREAM_SIZE / ms / 1e6);
+    }
+    return best;
+}
+
+/// <summary>The best floating point throughput of independent chains of multiply-adds, which never touch memory.
+/// Build with -march=native, so the chains are vectorised and the multiply-adds fused.</summary>
+/// <returns>The throughput in GFLOP/s.</returns>
+static double Peak() {
+    double best = 0.0;
+    for (int r = 0; r < PROBE_REPEATS; r++) {
+        double sum = 0.0;
+        double start = Shared::Now();
+        #pragma omp parallel reduction(+ : sum)
+        {
+            double chains[PEAK_CHAINS];
+            for (int j = 0; j < PEAK_CHAINS; j++) {
+                chains[j] = j;
+            }
+
+            // unrolled, the chains stay in vector registers instead of going through memory every step
+            for (int s = 0; s < PEAK_STEPS; s++) {
+                #pragma GCC unroll 64
+                for (int j = 0; j < PEAK_CHAINS; j++) {
+                    chains[j] = chains[j] * 0.999999 + 1e-6;
+                }
+            }
+
+            for (int j = 0; j < PEAK_CHAINS; j++) {
+                sum += chains[j];
+            }
+        }
+        double ms = Shared::Now() - start;
+
+        // the sum is used, so the chains are not optimised away
+        if (sum < 0.0) {
+            printf("%f\n", sum);
+        }
+        best = fmax(best, 2.0 * PEAK_CHAINS * PEAK_STEPS * Affinity::Threads() / ms / 1e6);
+    }
+    return best;
+}
+
+/// <summary>Measures the roofs of the roofline of this machine for 1 up to all threads:
+/// the memory bandwidth of the STREAM copy and triad in GB/s, and the peak floating point throughput in GFLOP/s.
+/// The solvers with COUNTERS enabled are placed below these roofs in Evaluation/Roofline.ipynb.</summary>
+int main() {
+    std::ofstream file = Shared::OpenFile("roofline", "Threads,Copy,Triad,Flops");
+
+    double* a = Shared::CreateMatrix(STREAM_SIZE);
+    double* b = Shared::CreateMatrix(STREAM_SIZE);
+    double* c = Shared::CreateMatrix(STREAM_SIZE);
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < STREAM_SIZE; i++) {
+        a[i] = 1.0;
+        b[i] = 2.0;
+    }
+
+    int threads = Affinity::Threads();
+    for (int t = 1; t <= threads; t++) {
+#ifdef _OPENMP
+        omp_set_num_threads(t);
+#endif
+        Affinity::Pin();
+
+        double copy = Copy(a, c);
+        double triad = Triad(a, b, c);
+        double flops = Peak();
+
+        file << t << "," << copy << "," << triad << "," << flops << std::endl;
+        printf("Threads=%d copy=%.2fGB/s triad=%.2fGB/s peak=%.2fGFLOP/s\n", t, copy, triad, flops);
+    }
+
+    Shared::FreeMatrix(a);
+    Shared::FreeMatrix(b);
+    Shared::FreeMatrix(c);
+    file.close();
+    return 0;
+}
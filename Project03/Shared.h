@@ -4,6 +4,10 @@
 #include <fstream>
 #include <math.h>
 #include <memory>
+#include <chrono>
+#include "Stencil.h"
+#include "Arena.h"
+#include "Counters.h"
 
 #define N 100
 #define HEAT 400.0
@@ -12,38 +16,114 @@
 #define STEPS 50
 #define REPEATS 10
 
+// stencil of a relaxation step, see Stencil.h
+#define STENCIL Stencils::Heat
+
+#define NORM_MAX 0
+#define NORM_L2 1
+
+// norm of the change made by an iteration, it is stable when this is at most the epsilon value
+#define NORM NORM_MAX
+// stability is only checked every CHECK_EVERY iterations,
+// after which the first stable iteration is found by rolling back
+#define CHECK_EVERY 1
+
+// OpenMP reduction that combines the partial norms of the threads, see Shared::Combine
+#if NORM == NORM_L2
+#define NORM_REDUCTION +
+#else
+#define NORM_REDUCTION max
+#endif
+
 class Shared {
 public:
-    /// <summary>Allocate a flattened matrix and initialise the values.</summary>
+    /// <summary>Allocate a flattened matrix from the arena and initialise the values.</summary>
+    /// <typeparam name="T">The type the matrix is stored in.</typeparam>
     /// <param name="size">The total size of the matrix.</param>
     /// <param name="heatIndex">At what index to place the heat, -1 if no heat should be added.</param>
     /// <param name="heat">The heat value to place.</param>
     /// <returns>A new matrix with the given size and potentially a heat value.</returns>
-    inline static double* CreateMatrix(size_t size, int heatIndex = -1, double heat = HEAT) {
-        double* m = (double*)calloc(size, sizeof(double));
+    template <typename T = double>
+    inline static T* CreateMatrix(size_t size, int heatIndex = -1, double heat = HEAT) {
+        T* m = (T*)Arena::Acquire(size * sizeof(T));
+
+        // a page is placed on the socket of the thread that first touches it, so the threads zero
+        // the same contiguous parts of the matrix that a static schedule over its rows gives them
+        #pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < size; i++) {
+            m[i] = T(0.0);
+        }
+
         if (heatIndex >= 0) {
-            m[heatIndex] = heat;
+            m[heatIndex] = T(heat);
         }
         return m;
     }
 
-    /// <summary>Diffuses a point using neighbouring values.</summary>
+    /// <summary>Returns a matrix of CreateMatrix to the arena.</summary>
+    /// <param name="m">The matrix, or NULL.</param>
+    inline static void FreeMatrix(void* m) {
+        Arena::Release(m);
+    }
+
+    /// <summary>Diffuses a point using neighbouring values, weighted by STENCIL.</summary>
+    /// <typeparam name="T">The type the matrix is stored in.</typeparam>
+    /// <typeparam name="C">The type the point is computed in.</typeparam>
     /// <param name="in">The original matrix.</param>
     /// <param name="out">The resulting matrix.</param>
     /// <param name="n">The width of the matrix.</param>
     /// <param name="i">The point to diffuse.</param>
-    inline static void Diffuse(double* in, double* out, size_t n, size_t i) {
-        out[i] = 0.25 * in[i]    // center
-            + 0.250 * in[i - n]  // upper
-            + 0.125 * in[i + n]  // lower
-            + 0.175 * in[i - 1]  // left
-            + 0.200 * in[i + 1]; // right
+    template <typename T, typename C = T>
+    inline static void Diffuse(const T* in, T* out, size_t n, size_t i) {
+        out[i] = T(Kernel<STENCIL>::Apply<T, C>(in, n, i));
+    }
+
+    /// <summary>Adds the change of a single point to a partial norm.</summary>
+    /// <param name="norm">The norm of the points so far.</param>
+    /// <param name="delta">The change of the point.</param>
+    /// <returns>The largest absolute change for NORM_MAX, the sum of squared changes for NORM_L2.</returns>
+    template <typename C>
+    inline static C Accumulate(C norm, C delta) {
+#if NORM == NORM_L2
+        return norm + delta * delta;
+#else
+        delta = delta < 0 ? -delta : delta;
+        return delta > norm ? delta : norm;
+#endif
+    }
+
+    /// <summary>Combines the partial norms of two parts of a matrix.</summary>
+    inline static double Combine(double a, double b) {
+#if NORM == NORM_L2
+        return a + b;
+#else
+        return a > b ? a : b;
+#endif
+    }
+
+    /// <summary>Checks the convergence criterion on the partial norm of a whole matrix.</summary>
+    /// <param name="norm">The combined norm of all points.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <returns>Whether the matrix is stable.</returns>
+    inline static bool IsStable(double norm, double eps) {
+#if NORM == NORM_L2
+        return sqrt(norm) <= eps;
+#else
+        return norm <= eps;
+#endif
+    }
+
+    /// <summary>Reads a monotonic wall clock. Unlike clock(), this does not add up the processor time of every thread.</summary>
+    /// <returns>The time in milliseconds since an arbitrary point.</returns>
+    inline static double Now() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
     }
 
     /// <summary>Opens a csv file and returns it.</summary>
     /// <param name="filename">The name of the file to open.</param>
+    /// <param name="header">The column names to write if the file is still empty.</param>
     /// <returns>The opened file.</returns>
-    inline static std::ofstream OpenFile(const std::string filename) {
+    inline static std::ofstream OpenFile(const std::string filename, const std::string header = "") {
         std::ofstream file;
         std::string path = "Evaluation/" + filename + ".csv";
         file.open(path, std::ios_base::app);
@@ -53,18 +133,37 @@ public:
             exit(1);
         }
 
+        file.seekp(0, std::ios_base::end);
+        if (!header.empty() && file.tellp() == 0) {
+            file << header << std::endl;
+        }
+
         return file;
     }
 
     /// <summary>Write information about the state of the program.</summary>
-    inline static void WriteInfo(std::ofstream& file, int n, int iterations, int ms, int cores = -1) {
+    /// <param name="cores">The number of processes, written as the first column if positive.</param>
+    /// <param name="cycles">The number of multigrid cycles, written as the last column if not negative.</param>
+    /// <param name="dims">The number of dimensions of the matrix, each of width n.</param>
+    /// <param name="counters">The hardware counters of the run, written as the last columns if given, see Counters::Write.</param>
+    /// <param name="point">The size of a point of the matrix in bytes, see Precision.h.</param>
+    inline static void WriteInfo(std::ofstream& file, int n, int iterations, int ms, int cores = -1, int cycles = -1, int dims = 2,
+                                 const CounterValues* counters = NULL, size_t point = sizeof(double)) {
         if (cores > 0) {
             file << cores << ",";
         }
 
         file << n << "," 
-             << (int)(n * n * sizeof(double) / (1024 * 1024)) << ","
+             << (int)(pow(n, dims) * point / (1024 * 1024)) << ","
              << iterations << ","
-             << ms << std::endl;
+             << ms;
+        if (cycles >= 0) {
+            file << "," << cycles;
+        }
+        if (counters != NULL) {
+            Counters::Write(file, *counters, ms);
+        }
+
+        file << std::endl;
     }
 };
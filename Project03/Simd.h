@@ -0,0 +1,190 @@
+#pragma once
+
+#include "Shared.h"
+#include <type_traits>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIMD_X86
+#endif
+
+class Simd {
+public:
+    /// <summary>A kernel that diffuses a segment of a row.</summary>
+    typedef double (*RowKernel)(double* in, double* out, size_t n, size_t y, size_t x0, size_t x1);
+
+    /// <summary>Diffuses the points [x0, x1) of row y using the fastest kernel this CPU supports.
+    /// Only doubles have vector kernels, other types use DiffuseRowTyped.</summary>
+    /// <typeparam name="T">The type the matrix is stored in.</typeparam>
+    /// <typeparam name="C">The type the points are computed in.</typeparam>
+    /// <param name="in">The original matrix.</param>
+    /// <param name="out">The resulting matrix.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="y">The row to diffuse.</param>
+    /// <param name="x0">The first column to diffuse.</param>
+    /// <param name="x1">The column after the last one to diffuse.</param>
+    /// <returns>The partial norm of the change of the segment, see Shared::Accumulate.</returns>
+    template <typename T = double, typename C = T>
+    inline static double DiffuseRow(T* in, T* out, size_t n, size_t y, size_t x0, size_t x1) {
+        if constexpr (std::is_same<T, double>::value && std::is_same<C, double>::value) {
+            static const RowKernel kernel = SelectRowKernel<true>();
+            return kernel(in, out, n, y, x0, x1);
+        } else {
+            return DiffuseRowTyped<true, T, C>(in, out, n, y, x0, x1);
+        }
+    }
+
+    /// <summary>Diffuses the points [x0, x1) of row y like DiffuseRow, without the norm of the change,
+    /// for the iterations that are not checked.</summary>
+    template <typename T = double, typename C = T>
+    inline static void SweepRow(T* in, T* out, size_t n, size_t y, size_t x0, size_t x1) {
+        if constexpr (std::is_same<T, double>::value && std::is_same<C, double>::value) {
+            static const RowKernel kernel = SelectRowKernel<false>();
+            kernel(in, out, n, y, x0, x1);
+        } else {
+            DiffuseRowTyped<false, T, C>(in, out, n, y, x0, x1);
+        }
+    }
+
+    /// <summary>Picks the widest row kernel supported by the CPU at runtime.</summary>
+    /// <typeparam name="Check">Whether the kernel computes the norm of the change.</typeparam>
+    template <bool Check = true>
+    inline static RowKernel SelectRowKernel() {
+#ifdef SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return DiffuseRowAvx512<Check>;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return DiffuseRowAvx2<Check>;
+        }
+#endif
+        return DiffuseRowScalar<Check>;
+    }
+
+    /// <summary>Diffuses a segment of a row one point at a time.
+    /// Every kernel only computes the norm of the change when Check is set, and returns 0 otherwise.</summary>
+    template <bool Check = true>
+    inline static double DiffuseRowScalar(double* in, double* out, size_t n, size_t y, size_t x0, size_t x1) {
+        double norm = 0.0;
+        for (size_t i = x0 + y * n; i < x1 + y * n; i++) {
+            Shared::Diffuse(in, out, n, i);
+            if constexpr (Check) {
+                norm = Shared::Accumulate(norm, in[i] - out[i]);
+            }
+        }
+
+        return norm;
+    }
+
+    /// <summary>Diffuses a segment of a row stored as T and computed in C, which the compiler vectorises.
+    /// The norm is of the change of the stored values, so a point that rounds back to itself counts as stable.</summary>
+    template <bool Check, typename T, typename C>
+    inline static double DiffuseRowTyped(T* in, T* out, size_t n, size_t y, size_t x0, size_t x1) {
+        C norm = C(0);
+        #pragma omp simd reduction(NORM_REDUCTION : norm)
+        for (size_t i = x0 + y * n; i < x1 + y * n; i++) {
+            Shared::Diffuse<T, C>(in, out, n, i);
+            if constexpr (Check) {
+                norm = Shared::Accumulate(norm, C(in[i]) - C(out[i]));
+            }
+        }
+
+        return (double)norm;
+    }
+
+#ifdef SIMD_X86
+    /// <summary>Diffuses a segment of a row four points at a time.</summary>
+    template <bool Check = true>
+    __attribute__((target("avx2")))
+    static double DiffuseRowAvx2(double* in, double* out, size_t n, size_t y, size_t x0, size_t x1) {
+#if NORM != NORM_L2
+        const __m256d sign = _mm256_set1_pd(-0.0);
+#endif
+        __m256d norm = _mm256_setzero_pd();
+
+        size_t i = x0 + y * n;
+        size_t end = x1 + y * n;
+        for (; i + 4 <= end; i += 4) {
+            __m256d v = SumAvx2(&in[i], (ptrdiff_t)n, std::make_index_sequence<STENCIL.points>());
+            _mm256_storeu_pd(&out[i], v);
+            if constexpr (Check) {
+                __m256d delta = _mm256_sub_pd(_mm256_loadu_pd(&in[i]), v);
+#if NORM == NORM_L2
+                norm = _mm256_add_pd(norm, _mm256_mul_pd(delta, delta));
+#else
+                norm = _mm256_max_pd(norm, _mm256_andnot_pd(sign, delta));
+#endif
+            }
+        }
+
+        double result = DiffuseRowScalar<Check>(in, out, n, 0, i, end);
+        if constexpr (!Check) {
+            return result;
+        }
+
+        double lanes[4];
+        _mm256_storeu_pd(lanes, norm);
+        for (int l = 0; l < 4; l++) {
+            result = Shared::Combine(result, lanes[l]);
+        }
+
+        return result;
+    }
+
+    /// <summary>Diffuses a segment of a row eight points at a time.
+    /// AVX-512 implies FMA, contraction is disabled to keep the results identical to the scalar kernel.</summary>
+    template <bool Check = true>
+    __attribute__((target("avx512f"), optimize("fp-contract=off")))
+    static double DiffuseRowAvx512(double* in, double* out, size_t n, size_t y, size_t x0, size_t x1) {
+        __m512d norm = _mm512_setzero_pd();
+
+        size_t i = x0 + y * n;
+        size_t end = x1 + y * n;
+        for (; i + 8 <= end; i += 8) {
+            __m512d v = SumAvx512(&in[i], (ptrdiff_t)n, std::make_index_sequence<STENCIL.points>());
+            _mm512_storeu_pd(&out[i], v);
+            if constexpr (Check) {
+                __m512d delta = _mm512_sub_pd(_mm512_loadu_pd(&in[i]), v);
+#if NORM == NORM_L2
+                norm = _mm512_add_pd(norm, _mm512_mul_pd(delta, delta));
+#else
+                norm = _mm512_max_pd(norm, _mm512_abs_pd(delta));
+#endif
+            }
+        }
+
+        double result = DiffuseRowScalar<Check>(in, out, n, 0, i, end);
+        if constexpr (!Check) {
+            return result;
+        }
+
+#if NORM == NORM_L2
+        return Shared::Combine(result, _mm512_reduce_add_pd(norm));
+#else
+        return Shared::Combine(result, _mm512_reduce_max_pd(norm));
+#endif
+    }
+
+private:
+    /// <summary>The weighted sum of STENCIL around four points, unrolled over the points of the stencil.
+    /// The products are added in the same order as Shared::Diffuse, so the results are identical.</summary>
+    template <size_t P0, size_t... P>
+    __attribute__((target("avx2"), always_inline))
+    inline static __m256d SumAvx2(const double* in, ptrdiff_t n, std::index_sequence<P0, P...>) {
+        __m256d v = _mm256_mul_pd(_mm256_set1_pd(STENCIL.w[P0]), _mm256_loadu_pd(&in[STENCIL.dy[P0] * n + STENCIL.dx[P0]]));
+        ((v = _mm256_add_pd(v, _mm256_mul_pd(_mm256_set1_pd(STENCIL.w[P]), _mm256_loadu_pd(&in[STENCIL.dy[P] * n + STENCIL.dx[P]])))), ...);
+        return v;
+    }
+
+    /// <summary>The weighted sum of STENCIL around eight points, see SumAvx2.</summary>
+    template <size_t P0, size_t... P>
+    __attribute__((target("avx512f"), optimize("fp-contract=off"), always_inline))
+    inline static __m512d SumAvx512(const double* in, ptrdiff_t n, std::index_sequence<P0, P...>) {
+        __m512d v = _mm512_mul_pd(_mm512_set1_pd(STENCIL.w[P0]), _mm512_loadu_pd(&in[STENCIL.dy[P0] * n + STENCIL.dx[P0]]));
+        ((v = _mm512_add_pd(v, _mm512_mul_pd(_mm512_set1_pd(STENCIL.w[P]), _mm512_loadu_pd(&in[STENCIL.dy[P] * n + STENCIL.dx[P]])))), ...);
+        return v;
+    }
+#endif
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stddef.h>
+#include <utility>
+
+/// <summary>Describes a stencil of P points, point p lies at offset (dy[p], dx[p]) and has weight w[p].
+/// The weighted sum is taken in the order of the points, so a stencil gives the same results
+/// as a hand-written sum in the same order.</summary>
+template <size_t P>
+struct Stencil {
+    static constexpr size_t points = P;
+    int dy[P];
+    int dx[P];
+    double w[P];
+
+    /// <summary>Whether a point lies diagonally from the center, so it couples points of the same red-black colour
+    /// and needs the corners of the halo.</summary>
+    constexpr bool Diagonal() const {
+        for (size_t p = 0; p < P; p++) {
+            if (dy[p] != 0 && dx[p] != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// <summary>The largest distance of a point from the center along y or x.</summary>
+    constexpr int Reach() const {
+        int reach = 0;
+        for (size_t p = 0; p < P; p++) {
+            int d = dy[p] < 0 ? -dy[p] : dy[p];
+            reach = d > reach ? d : reach;
+            d = dx[p] < 0 ? -dx[p] : dx[p];
+            reach = d > reach ? d : reach;
+        }
+        return reach;
+    }
+
+    /// <summary>The floating point operations of relaxing a single point: a multiplication per point, an addition
+    /// per point but the first, and two more for the norm of the change.</summary>
+    constexpr size_t Flops() const {
+        return 2 * P + 1;
+    }
+};
+
+/// <summary>Describes a 3D stencil of P points, point p lies at offset (dz[p], dy[p], dx[p]) and has weight w[p].</summary>
+template <size_t P>
+struct Stencil3D {
+    static constexpr size_t points = P;
+    int dz[P];
+    int dy[P];
+    int dx[P];
+    double w[P];
+
+    /// <summary>The floating point operations of relaxing a single point, see Stencil::Flops.</summary>
+    constexpr size_t Flops() const {
+        return 2 * P + 1;
+    }
+};
+
+class Stencils {
+public:
+    /// <summary>The 1D 3-point stencil of Project01: left, center and right.</summary>
+    static constexpr Stencil<3> Line = {
+        { 0, 0, 0 },
+        { -1, 0, 1 },
+        { 0.25, 0.5, 0.25 },
+    };
+
+    /// <summary>The 2D 5-point heat stencil: center, upper, lower, left and right.</summary>
+    static constexpr Stencil<5> Heat = {
+        { 0, -1, 1, 0, 0 },
+        { 0, 0, 0, -1, 1 },
+        { 0.25, 0.250, 0.125, 0.175, 0.200 },
+    };
+
+    /// <summary>A 2D 9-point stencil: center, upper, lower, left, right and the four corners.</summary>
+    static constexpr Stencil<9> Box = {
+        { 0, -1, 1, 0, 0, -1, -1, 1, 1 },
+        { 0, 0, 0, -1, 1, -1, 1, -1, 1 },
+        { 0.20, 0.15, 0.15, 0.15, 0.15, 0.05, 0.05, 0.05, 0.05 },
+    };
+
+    /// <summary>The 3D 7-point heat stencil: center, front, back, upper, lower, left and right.</summary>
+    static constexpr Stencil3D<7> Heat7 = {
+        { 0, -1, 1, 0, 0, 0, 0 },
+        { 0, 0, 0, -1, 1, 0, 0 },
+        { 0, 0, 0, 0, 0, -1, 1 },
+        { 0.25, 0.125, 0.125, 0.125, 0.125, 0.125, 0.125 },
+    };
+};
+
+/// <summary>Kernels generated from a stencil, with the sum over its points fully unrolled at compile time.</summary>
+template <const auto& S>
+class Kernel {
+public:
+    /// <summary>Computes the weighted sum of the stencil around a point.</summary>
+    /// <typeparam name="T">The type the matrix is stored in.</typeparam>
+    /// <typeparam name="C">The type the sum is computed in.</typeparam>
+    /// <param name="in">The matrix.</param>
+    /// <param name="n">The width of the matrix, unused by a 1D stencil.</param>
+    /// <param name="i">The point to compute.</param>
+    template <typename T, typename C = T>
+    inline static C Apply(const T* in, size_t n, size_t i) {
+        return Sum<T, C>(in + i, (ptrdiff_t)n, std::make_index_sequence<S.points>());
+    }
+
+    /// <summary>Computes the weighted sum of the stencil around a point, for rows that are not stored next to each other.
+    /// Requires a stencil that reaches one row up and down at most.</summary>
+    /// <param name="rows">The row of the point, rows[-1] and rows[1] are the rows above and below it.</param>
+    /// <param name="x">The column of the point.</param>
+    template <typename T, typename C = T>
+    inline static C ApplyRows(const T* const* rows, size_t x) {
+        return SumRows<T, C>(rows, x, std::make_index_sequence<S.points>());
+    }
+
+private:
+    template <typename T, typename C, size_t... P>
+    inline static C Sum(const T* in, ptrdiff_t n, std::index_sequence<P...>) {
+        return (... + (C(S.w[P]) * C(in[S.dy[P] * n + S.dx[P]])));
+    }
+
+    template <typename T, typename C, size_t... P>
+    inline static C SumRows(const T* const* rows, size_t x, std::index_sequence<P...>) {
+        return (... + (C(S.w[P]) * C(rows[S.dy[P]][x + S.dx[P]])));
+    }
+};
+
+/// <summary>Kernels generated from a 3D stencil, see Kernel.</summary>
+template <const auto& S>
+class Kernel3D {
+public:
+    /// <summary>Computes the weighted sum of the stencil around a point.</summary>
+    /// <param name="in">The volume.</param>
+    /// <param name="width">The distance between two rows.</param>
+    /// <param name="plane">The distance between two planes.</param>
+    /// <param name="i">The point to compute.</param>
+    template <typename T, typename C = T>
+    inline static C Apply(const T* in, size_t width, size_t plane, size_t i) {
+        return Sum<T, C>(in + i, (ptrdiff_t)width, (ptrdiff_t)plane, std::make_index_sequence<S.points>());
+    }
+
+private:
+    template <typename T, typename C, size_t... P>
+    inline static C Sum(const T* in, ptrdiff_t width, ptrdiff_t plane, std::index_sequence<P...>) {
+        return (... + (C(S.w[P]) * C(in[S.dz[P] * plane + S.dy[P] * width + S.dx[P]])));
+    }
+};
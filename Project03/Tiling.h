@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Shared.h"
+#include "Simd.h"
+#include "Active.h"
+#include <unistd.h>
+
+// tile shape of the tiled sweep, 0 means detect it from the cache size
+#define TILE_WIDTH 0
+#define TILE_HEIGHT 0
+
+class Tiling {
+public:
+    /// <summary>The shape of a tile in points.</summary>
+    struct Tile {
+        size_t width;
+        size_t height;
+    };
+
+    /// <summary>Reads the size of the L2 cache of this machine.</summary>
+    /// <returns>The size of the cache in bytes, 256KB if it could not be detected.</returns>
+    inline static size_t CacheSize() {
+        long size = -1;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+        size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+        if (size <= 0) {
+            FILE* file = fopen("/sys/devices/system/cpu/cpu0/cache/index2/size", "r");
+            if (file != NULL) {
+                char unit = 'K';
+                if (fscanf(file, "%ld%c", &size, &unit) >= 1) {
+                    size *= unit == 'M' ? 1024 * 1024 : 1024;
+                }
+                fclose(file);
+            }
+        }
+
+        return size > 0 ? (size_t)size : 256 * 1024;
+    }
+
+    /// <summary>Picks a tile shape such that the input and output of a tile fill about half the L2 cache.</summary>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="rows">The number of rows of the matrix.</param>
+    /// <typeparam name="T">The type the matrix is stored in.</typeparam>
+    /// <returns>The configured tile shape, or a detected one for every dimension that is 0.</returns>
+    template <typename T = double>
+    inline static Tile GetTile(size_t n, size_t rows) {
+        size_t points = CacheSize() / 2 / (2 * sizeof(T));
+
+        Tile tile;
+        tile.width = TILE_WIDTH > 0 ? TILE_WIDTH : points / 16;
+        tile.width = tile.width < 8 ? 8 : tile.width - tile.width % 8;
+        tile.width = tile.width > n - 2 ? n - 2 : tile.width;
+
+        tile.height = TILE_HEIGHT > 0 ? TILE_HEIGHT : points / tile.width - 2;
+        tile.height = tile.height < 1 ? 1 : tile.height;
+        tile.height = tile.height > rows - 2 ? rows - 2 : tile.height;
+        return tile;
+    }
+
+    /// <summary>Individual step of the 5-point stencil, one tile at a time.
+    /// A tile as wide and as high as the inner matrix is the same as sweeping row by row.</summary>
+    /// <param name="in">The original matrix.</param>
+    /// <param name="out">The resulting matrix.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="rows">The number of rows of the matrix.</param>
+    /// <param name="tile">The shape of a tile.</param>
+    /// <returns>The partial norm of the change of the matrix, see Shared::Accumulate.</returns>
+    template <typename T = double, typename C = T>
+    inline static double Relax(T* in, T* out, size_t n, size_t rows, Tile tile) {
+        return Relax<T, C>(in, out, n, rows, tile, Active::Inner(n, rows));
+    }
+
+    /// <summary>Individual step of the 5-point stencil on a region of the matrix, one tile at a time.
+    /// The tiles stay where they are without a region and are cut off at its edges,
+    /// so the norm of the change is added up in the same order.</summary>
+    /// <typeparam name="T">The type the matrix is stored in.</typeparam>
+    /// <typeparam name="C">The type the points are computed in.</typeparam>
+    /// <param name="in">The original matrix.</param>
+    /// <param name="out">The resulting matrix.</param>
+    /// <param name="n">The width of the matrix.</param>
+    /// <param name="rows">The number of rows of the matrix.</param>
+    /// <param name="tile">The shape of a tile.</param>
+    /// <param name="region">The inner points to sweep, see Active::Get.</param>
+    /// <param name="check">Whether to compute the norm of the change, see Simd::SweepRow.</param>
+    /// <returns>The partial norm of the change of the region, see Shared::Accumulate, 0 when not checked.</returns>
+    template <typename T = double, typename C = T>
+    inline static double Relax(T* in, T* out, size_t n, size_t rows, Tile tile, Region region, bool check = true) {
+        // the region never reaches past the inner rows
+        region.y1 = region.y1 < rows - 1 ? region.y1 : rows - 1;
+        size_t top = 1 + (region.y0 - 1) / tile.height * tile.height;
+        size_t left = 1 + (region.x0 - 1) / tile.width * tile.width;
+
+        double norm = 0.0;
+        #pragma omp parallel for schedule(static) reduction(NORM_REDUCTION : norm)
+        for (size_t y0 = top; y0 < region.y1; y0 += tile.height) {
+            size_t y1 = y0 + tile.height < region.y1 ? y0 + tile.height : region.y1;
+            for (size_t x0 = left; x0 < region.x1; x0 += tile.width) {
+                size_t x1 = x0 + tile.width < region.x1 ? x0 + tile.width : region.x1;
+                for (size_t y = y0 > region.y0 ? y0 : region.y0; y < y1; y++) {
+                    if (check) {
+                        norm = Shared::Combine(norm, Simd::DiffuseRow<T, C>(in, out, n, y, x0 > region.x0 ? x0 : region.x0, x1));
+                    } else {
+                        Simd::SweepRow<T, C>(in, out, n, y, x0 > region.x0 ? x0 : region.x0, x1);
+                    }
+                }
+            }
+        }
+
+        return norm;
+    }
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Shared.h"
+#include "Tiling.h"
+
+// a volume grows much faster than a matrix, so the sizes grow by N_3D instead of N
+#define N_3D 5
+// stencil of a relaxation step of a volume, see Stencil.h
+#define STENCIL_3D Stencils::Heat7
+
+/// <summary>Relaxation of a flattened n*n*n volume, stored plane by plane and row by row.
+/// The heat is placed in the middle of the upper face.</summary>
+class Volume {
+public:
+    /// <summary>Calculates the index of the heat.</summary>
+    /// <param name="n">The width of the volume.</param>
+    inline static size_t GetHeatIndex(size_t n) {
+        return (n / 2) * n * n + n / 2;
+    }
+
+    /// <summary>Picks a tile shape along y and x such that the three planes of the input that a tile reads
+    /// and the plane of the output it writes fill about half the L2 cache. Every tile is swept along all of z,
+    /// so each plane of the input is loaded once per tile.</summary>
+    /// <param name="cols">The number of columns to tile.</param>
+    /// <param name="rows">The number of rows to tile.</param>
+    /// <returns>The configured tile shape of Tiling, or a detected one for every dimension that is 0.</returns>
+    inline static Tiling::Tile GetTile(size_t cols, size_t rows) {
+        size_t points = Tiling::CacheSize() / 2 / (4 * sizeof(double));
+
+        Tiling::Tile tile;
+        tile.width = TILE_WIDTH > 0 ? TILE_WIDTH : points / 16;
+        tile.width = tile.width < 8 ? 8 : tile.width - tile.width % 8;
+        tile.width = tile.width > cols ? cols : tile.width;
+
+        tile.height = TILE_HEIGHT > 0 ? TILE_HEIGHT : points / tile.width;
+        tile.height = tile.height < 1 ? 1 : tile.height;
+        tile.height = tile.height > rows ? rows : tile.height;
+        return tile;
+    }
+
+    /// <summary>Relaxes a box of a volume with the 3D stencil, one tile of rows and columns at a time.</summary>
+    /// <param name="in">The original volume.</param>
+    /// <param name="out">The resulting volume.</param>
+    /// <param name="width">The distance between two rows.</param>
+    /// <param name="plane">The distance between two planes.</param>
+    /// <param name="first">The first point to relax along z, y and x.</param>
+    /// <param name="last">The point after the last one to relax along z, y and x.</param>
+    /// <param name="tile">The shape of a tile along y and x.</param>
+    /// <returns>The partial norm of the change of the box, see Shared::Accumulate.</returns>
+    inline static double Relax(double* in, double* out, size_t width, size_t plane,
+                               const size_t first[3], const size_t last[3], Tiling::Tile tile) {
+        if (first[0] >= last[0] || first[1] >= last[1] || first[2] >= last[2]) {
+            return 0.0;
+        }
+
+        size_t tilesY = (last[1] - first[1] + tile.height - 1) / tile.height;
+        size_t tilesX = (last[2] - first[2] + tile.width - 1) / tile.width;
+
+        double norm = 0.0;
+        #pragma omp parallel for collapse(2) schedule(static) reduction(NORM_REDUCTION : norm)
+        for (size_t ty = 0; ty < tilesY; ty++) {
+            for (size_t tx = 0; tx < tilesX; tx++) {
+                size_t y0 = first[1] + ty * tile.height;
+                size_t y1 = y0 + tile.height < last[1] ? y0 + tile.height : last[1];
+                size_t x0 = first[2] + tx * tile.width;
+                size_t x1 = x0 + tile.width < last[2] ? x0 + tile.width : last[2];
+
+                for (size_t z = first[0]; z < last[0]; z++) {
+                    for (size_t y = y0; y < y1; y++) {
+                        norm = Shared::Combine(norm, RelaxRow(in, out, width, plane, z * plane + y * width, x0, x1));
+                    }
+                }
+            }
+        }
+
+        return norm;
+    }
+
+    /// <summary>Relaxes a volume until it is stable. The outer points of the volume are never relaxed.</summary>
+    /// <param name="in">The volume to start from, swapped with out after every unstable iteration.</param>
+    /// <param name="out">A second volume with the same boundary values, which ends up holding the stable iteration.</param>
+    /// <param name="n">The width of the volume.</param>
+    /// <param name="eps">The epsilon value.</param>
+    /// <param name="tile">The shape of a tile along y and x.</param>
+    /// <returns>The number of iterations.</returns>
+    inline static int Solve(double*& in, double*& out, size_t n, double eps, Tiling::Tile tile) {
+        size_t first[3] = { 1, 1, 1 };
+        size_t last[3] = { n - 1, n - 1, n - 1 };
+
+        int iterations = 1;
+        while (!Shared::IsStable(Relax(in, out, n, n * n, first, last, tile), eps)) {
+            double* tmp = in;
+            in = out;
+            out = tmp;
+            iterations++;
+        }
+
+        return iterations;
+    }
+
+    /// <summary>Relaxes the points [x0, x1) of a row.</summary>
+    /// <param name="row">The index of the first point of the row.</param>
+    /// <returns>The partial norm of the change of the row, see Shared::Accumulate.</returns>
+    inline static double RelaxRow(double* in, double* out, size_t width, size_t plane, size_t row, size_t x0, size_t x1) {
+        double norm = 0.0;
+        #pragma omp simd reduction(NORM_REDUCTION : norm)
+        for (size_t i = row + x0; i < row + x1; i++) {
+            out[i] = Kernel3D<STENCIL_3D>::Apply(in, width, plane, i);
+            norm = Shared::Accumulate(norm, in[i] - out[i]);
+        }
+
+        return norm;
+    }
+};